@@ -13,6 +13,9 @@
 #include <SystemTrayIcon.h>
 #include <BackgroundMultiuserLogger.h>
 
+//turn this down to LogLevel::Debug or LogLevel::Trace while the program is running to see more, with LogCategory::setLevel("BackgroundJobs", ...)
+static LogCategory backgroundJobsLog { "BackgroundJobs", LogLevel::Info };
+
 struct BackgroundJob : juce::Thread
 {
     BackgroundJob(int num);
@@ -36,11 +39,12 @@ void BackgroundJob::run()
             break;
         }
         
-        BML::writeToLog(getThreadName() + " decrementing the counter. remaining: " + juce::String(counter) );
+        BML_LOG(Info, backgroundJobsLog, "%s decrementing the counter. remaining: %d", getThreadName(), counter);
         wait(500);
         --counter;
     }
     
+    BML_LOG_FIELDS(Info, backgroundJobsLog, "job finished", logField("stoppedEarly", counter > 0), logField("remaining", counter));
     BML::writeToLog(getThreadName() + " has finished running" );
 }
 
@@ -65,6 +69,14 @@ private:
     void configureLogger();
 #if JUCE_MAC
     std::unique_ptr<DummyMenuBarModel> model;
+    
+    //the signal handler can only note which signal arrived, so the message thread checks for one, and does the logging and quitting.
+    struct SignalWatcher : juce::Timer
+    {
+        void timerCallback() override;
+    };
+    
+    SignalWatcher signalWatcher;
 #endif
     std::unique_ptr<SystemTrayIcon> systemTrayIcon;
     
@@ -78,10 +90,18 @@ LoggerExample::LoggerExample()
      Decide if you want to also log to std::cout.
      Decide if you want the log file revealed when the program exits.
      Decide if you want the messages to have timestamps
+     Decide if you want the messages written from the message thread, or from a background writer thread
      */
     BML::getInstance()->configure(LoggerWithOptionalCout::LogOptions::LogToCout,
                                   BML::RevealOptions::RevealOnExit,
-                                  BML::MessageTimestampOptions::Show);
+                                  BML::MessageTimestampOptions::Show,
+                                  BML::WriterThreadOptions::BackgroundThread);
+    
+    /*
+     if the program crashes, save the messages that hadn't reached the log file yet to a .bmdump file, which RingLogRecovery can read.
+     SIGINT and SIGTERM are left to the signalHandler below, which quits gracefully.
+     */
+    BML::installEmergencyDrain();
 }
 
 LoggerExample::~LoggerExample()
@@ -96,31 +116,43 @@ const juce::String LoggerExample::getApplicationName()     { return ProjectInfo:
 const juce::String LoggerExample::getApplicationVersion()  { return ProjectInfo::versionString; }
 
 #if JUCE_MAC
+/*
+ only async-signal-safe things can be done in a signal handler, which rules out logging, juce::String, and quitting the app.
+ So the handler just notes the signal, and the SignalWatcher picks it up on the message thread.
+ */
+static volatile std::sig_atomic_t receivedSignal = 0;
+
 void signalHandler(int signal)
 {
+    receivedSignal = signal;
+}
+
+void LoggerExample::SignalWatcher::timerCallback()
+{
+    int signal = receivedSignal;
+    if( signal == 0 )
+    {
+        return;
+    }
+    
+    receivedSignal = 0;
+    
     if( signal == SIGINT )
     {
         BML::writeToLog("Received SIGINT signal, exiting gracefully...");
-        if( auto instance = juce::JUCEApplication::getInstance() )
-        {
-            instance->systemRequestedQuit();
-        }
     }
     else if( signal == SIGTERM )
     {
         BML::writeToLog("Received SIGTERM signal, exiting gracefully...");
-        if( auto instance = juce::JUCEApplication::getInstance() )
-        {
-            instance->systemRequestedQuit();
-        }
     }
     else
     {
         BML::writeToLog("Received unknown signal: " + juce::String(signal) + ", exiting gracefully...");
-        if( auto instance = juce::JUCEApplication::getInstance() )
-        {
-            instance->systemRequestedQuit();
-        }
+    }
+    
+    if( auto instance = juce::JUCEApplication::getInstance() )
+    {
+        instance->systemRequestedQuit();
     }
 }
 #endif
@@ -134,6 +166,7 @@ void LoggerExample::initialise (const juce::String& commandLineParameters)
 
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+    signalWatcher.startTimer(100);
 #endif
     
     systemTrayIcon = std::make_unique<SystemTrayIcon>();
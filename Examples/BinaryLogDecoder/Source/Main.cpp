@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    Converts a binary log written by the BackgroundMultiuserLogger back into text.
+
+    usage: BinaryLogDecoder <input.bmlog> [output.log]
+    Without an output file, the text is written to std::cout.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#include <BinaryLogFormat.h>
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+    
+    if( args.size() < 1 || args.size() > 2 )
+    {
+        std::cerr << "usage: " << args.executableName << " <input.bmlog> [output.log]" << std::endl;
+        return 1;
+    }
+    
+    auto inputFile = args[0].resolveAsFile();
+    juce::MemoryBlock binaryLog;
+    if( inputFile.loadFileAsData(binaryLog) == false )
+    {
+        std::cerr << "couldn't read " << inputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+    
+    juce::MemoryOutputStream text;
+    auto result = BinaryLogDecoder::decode(binaryLog.getData(), binaryLog.getSize(), text);
+    
+    //whatever was decoded is still worth having, even if the log was cut short
+    if( args.size() == 2 )
+    {
+        auto outputFile = args[1].resolveAsFile();
+        if( outputFile.replaceWithData(text.getData(), text.getDataSize()) == false )
+        {
+            std::cerr << "couldn't write " << outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout.write(static_cast<const char*>(text.getData()), static_cast<std::streamsize>(text.getDataSize()));
+        std::cout.flush();
+    }
+    
+    if( result.failed() )
+    {
+        std::cerr << inputFile.getFileName() << ": " << result.getErrorMessage() << std::endl;
+        return 1;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    Recovers the last messages a crashed program logged, from the crash ring the BackgroundMultiuserLogger left next to its log file.
+    It reads the emergency drain's .bmdump files too, as they are written in the same format.
+
+    usage: RingLogRecovery <input.bmring> [output.log]
+    Without an output file, the text is written to std::cout.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#include <MappedRingLog.h>
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+    
+    if( args.size() < 1 || args.size() > 2 )
+    {
+        std::cerr << "usage: " << args.executableName << " <input.bmring> [output.log]" << std::endl;
+        return 1;
+    }
+    
+    auto inputFile = args[0].resolveAsFile();
+    juce::MemoryBlock ring;
+    if( inputFile.loadFileAsData(ring) == false )
+    {
+        std::cerr << "couldn't read " << inputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+    
+    juce::MemoryOutputStream text;
+    auto result = MappedRingLog::recover(ring.getData(), ring.getSize(), text);
+    if( result.failed() )
+    {
+        std::cerr << inputFile.getFileName() << ": " << result.getErrorMessage() << std::endl;
+        return 1;
+    }
+    
+    if( args.size() == 2 )
+    {
+        auto outputFile = args[1].resolveAsFile();
+        if( outputFile.replaceWithData(text.getData(), text.getDataSize()) == false )
+        {
+            std::cerr << "couldn't write " << outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout.write(static_cast<const char*>(text.getData()), static_cast<std::streamsize>(text.getDataSize()));
+        std::cout.flush();
+    }
+    
+    return 0;
+}
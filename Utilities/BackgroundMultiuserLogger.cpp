@@ -10,34 +10,99 @@
 
 #include "BackgroundMultiuserLogger.h"
 
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+ #include <pthread.h>
+ #if JUCE_BSD
+  #include <pthread_np.h>
+ #endif
+#endif
+
+namespace
+{
+    /*
+     the loggers that haven't started being destroyed, by ID.
+     A thread that exits only touches its logger while holding 'lock', and a logger takes itself out of here before it destroys anything,
+     so the logger can't be destroyed while the thread is retiring its producer.
+     */
+    struct LiveLoggers
+    {
+        juce::CriticalSection lock;
+        std::unordered_map<juce::uint64, BackgroundMultiuserLogger*> loggers;
+    };
+    
+    LiveLoggers& getLiveLoggers()
+    {
+        static LiveLoggers liveLoggers;
+        return liveLoggers;
+    }
+}
 
 BackgroundMultiuserLogger::BackgroundMultiuserLogger()
 {
-    mpscFifo = std::make_unique<TimedMPSCFifo>();
-    messagePurger = std::make_unique<TimerRunner<BackgroundMultiuserLogger, 25>>(*this, &BackgroundMultiuserLogger::flushMessagesFromFifo, TimerLaunchType::StartWhenSignaled);
-    messagePurger->launch();
+    //the fifo, and whatever drains it, are created by the first call to configure().
+    auto& liveLoggers = getLiveLoggers();
+    const juce::ScopedLock lock(liveLoggers.lock);
+    liveLoggers.loggers.emplace(loggerID, this);
 };
 
 BackgroundMultiuserLogger::~BackgroundMultiuserLogger()
 {
-    flushMessagesFromFifo();
-    if( messagePurger )
-        messagePurger->halt();
+    //from here on, no thread that exits can reach this logger, and getInstanceWithoutCreating() doesn't return it
+    {
+        auto& liveLoggers = getLiveLoggers();
+        const juce::ScopedLock liveLoggersLock(liveLoggers.lock);
+        const juce::ScopedLock lock(indexesLock);
+        liveLoggers.loggers.erase(loggerID);
+        clearSingletonInstance();
+    }
     
-    messagePurger.reset();
+    stopWriting();
+    
+    if( mpscFifo )
+    {
+        //the messages suppressed since the last report would otherwise never be counted
+        reportSuppressedMessages();
+        flushMessagesFromFifo();
+    }
+    
+    //the fifos are about to go, so there's nothing left for a crash to drain
+    emergencyDrain.reset();
+    
+    //the Producer handles must be released before the MPSCFifo that created them is destroyed.
+    {
+        const juce::ScopedLock lock(indexesLock);
+        producerIndexes.clear();
+        retiredProducers.clear();
+    }
     
+    drainedProducers.clear();
     mpscFifo.reset();
     
+    //everything in the crash ring made it to the log file, so it's only kept after a crash
+    if( crashRing != nullptr )
+    {
+        auto ringFile = crashRing->getFile();
+        crashRing.reset();
+        ringFile.deleteFile();
+    }
+    
     if( fileLogger && revealOnExit == RevealOptions::RevealOnExit )
-        fileLogger->getLogFile().revealToUser();
+        getLogFile().revealToUser();
     
     fileLogger.reset();
-    clearSingletonInstance();
+    binaryLog.reset();
+    jsonLog.reset();
 }
 
 void BackgroundMultiuserLogger::configure(LoggerWithOptionalCout::LogOptions alsoLogToCout,
                                           RevealOptions revealLogFileOnExit,
-                                          MessageTimestampOptions withTimestamp)
+                                          MessageTimestampOptions withTimestamp,
+                                          WriterThreadOptions writerThreadOptions,
+                                          juce::Thread::Priority writerPriority,
+                                          WriteDurability durability,
+                                          LogFileFormat fileFormat,
+                                          LogRotationOptions rotation,
+                                          CrashRingOptions crashRingOptions)
 {
     auto welcomeMessage = juce::String("Welcome to ") + ProjectInfo::projectName;
     welcomeMessage << " ";
@@ -45,22 +110,150 @@ void BackgroundMultiuserLogger::configure(LoggerWithOptionalCout::LogOptions als
     welcomeMessage << " spawned at ";
     welcomeMessage << juce::Time::getCurrentTime().toISO8601(true);
     
-    auto logger = std::unique_ptr<juce::FileLogger>(juce::FileLogger::createDateStampedLogger(ProjectInfo::projectName, "session", ".log", welcomeMessage));
-    fileLogger = std::make_unique<LoggerWithOptionalCout>(alsoLogToCout, std::move(logger));
+    if( fileFormat == LogFileFormat::Binary )
+    {
+        auto writer = std::make_unique<BatchedFileWriter>(createLogFile(".bmlog"), durability, rotation);
+        
+        juce::MemoryOutputStream header;
+        BinaryLogEncoder::writeHeader(header, withTimestamp == MessageTimestampOptions::Show);
+        BinaryLogEncoder::writeBanner(header, clock.getStartTimeMillis(), createBanner(welcomeMessage));
+        writer->writeBatch(static_cast<const char*>(header.getData()), header.getDataSize());
+        
+        //the writer thread may be writing to the old log
+        const juce::ScopedLock lock(writerLock);
+        fileLogger = std::make_unique<LoggerWithOptionalCout>(alsoLogToCout, nullptr);
+        binaryLog = std::move(writer);
+        binaryEncoder = {};
+        jsonLog.reset();
+        
+        revealOnExit = revealLogFileOnExit;
+        withTS = withTimestamp;
+    }
+    else if( fileFormat == LogFileFormat::JsonLines )
+    {
+        auto writer = std::make_unique<BatchedFileWriter>(createLogFile(".jsonl"), durability, rotation);
+        
+        //every line has to be a JSON object, so the banner is one too
+        std::string banner = "{\"message\":";
+        LogArguments::appendJsonString(banner, welcomeMessage.toStdString());
+        
+        //the wall-clock time that each message's "time_ms" counts from
+        banner += ",\"start_time_ms\":";
+        banner += std::to_string(clock.getStartTimeMillis());
+        banner += "}\n";
+        writer->writeBatch(banner.data(), banner.size());
+        
+        //the writer thread may be writing to the old log
+        const juce::ScopedLock lock(writerLock);
+        fileLogger = std::make_unique<LoggerWithOptionalCout>(alsoLogToCout, nullptr);
+        binaryLog.reset();
+        jsonLog = std::move(writer);
+        
+        revealOnExit = revealLogFileOnExit;
+        withTS = withTimestamp;
+    }
+    else
+    {
+        if( withTimestamp == MessageTimestampOptions::Show )
+        {
+            welcomeMessage << juce::newLine << LogClock::describeTimestamps(clock.getStartTimeMillis());
+        }
+        
+        auto logger = std::unique_ptr<juce::FileLogger>(juce::FileLogger::createDateStampedLogger(ProjectInfo::projectName, "session", ".log", welcomeMessage));
+        
+        //the writer thread may be writing to the old fileLogger
+        const juce::ScopedLock lock(writerLock);
+        binaryLog.reset();
+        jsonLog.reset();
+        fileLogger = std::make_unique<LoggerWithOptionalCout>(alsoLogToCout, std::move(logger), durability, rotation);
+        
+        revealOnExit = revealLogFileOnExit;
+        withTS = withTimestamp;
+    }
     
-    revealOnExit = revealLogFileOnExit;
-    withTS = withTimestamp;
+    if( mpscFifo == nullptr )
+    {
+        if( crashRingOptions.numSlots > 0 )
+        {
+            crashRing = std::make_unique<MappedRingLog>(getLogFile().withFileExtension(".bmring"),
+                                                        crashRingOptions,
+                                                        withTimestamp == MessageTimestampOptions::Show,
+                                                        clock);
+        }
+        
+        startWriting(writerThreadOptions, writerPriority);
+    }
     
     isConfigured = true;
 }
 
-void BackgroundMultiuserLogger::writeToLog(const juce::String& message)
+void BackgroundMultiuserLogger::startWriting(WriterThreadOptions writerThreadOptions,
+                                             juce::Thread::Priority writerPriority)
+{
+    suppressionReporter = std::make_unique<TimerRunner<BackgroundMultiuserLogger, 1000>>(*this, &BackgroundMultiuserLogger::reportSuppressedMessages);
+    
+    if( writerThreadOptions == WriterThreadOptions::BackgroundThread )
+    {
+        //the producers ring the fifo's doorbell, and the writer thread does the draining.
+        ConsumerDrainOptions drainOptions;
+        drainOptions.mode = ConsumerDrainMode::External;
+        mpscFifo = std::make_unique<TimedMPSCFifo>(drainOptions);
+        
+        writerThread = std::make_unique<ThreadRunner<BackgroundMultiuserLogger>>(*this,
+                                                                                "BML Writer",
+                                                                                &BackgroundMultiuserLogger::writeOnBackgroundThread,
+                                                                                &BackgroundMultiuserLogger::canRunWriterThread,
+                                                                                ThreadLaunchType::Immediately,
+                                                                                writerPriority);
+        return;
+    }
+    
+    mpscFifo = std::make_unique<TimedMPSCFifo>();
+    messagePurger = std::make_unique<TimerRunner<BackgroundMultiuserLogger, 25>>(*this, &BackgroundMultiuserLogger::flushMessagesFromFifo, TimerLaunchType::StartWhenSignaled);
+    messagePurger->launch();
+}
+
+void BackgroundMultiuserLogger::stopWriting()
+{
+    suppressionReporter.reset();
+    
+    if( messagePurger )
+        messagePurger->halt();
+    
+    messagePurger.reset();
+    
+    if( writerThread )
+    {
+        //the writer thread is most likely asleep in waitForItems(), so wake it up to see that it should exit.
+        writerThread->signalThreadShouldExit();
+        mpscFifo->wakeConsumer();
+        writerThread.reset();
+    }
+}
+
+void BackgroundMultiuserLogger::reportSuppressedMessages()
+{
+    LogCallSite::reportSuppressedMessages([this](const LogCategory& category, LogLevel level, const char* format, juce::uint64 numSuppressed)
+    {
+        logInternal(&category, level, "suppressed %llu similar messages: %s", numSuppressed, format);
+    });
+}
+
+void BackgroundMultiuserLogger::writeOnBackgroundThread(juce::Thread& thread)
+{
+    if( mpscFifo->waitForItems(thread) )
+    {
+        flushMessagesFromFifo();
+    }
+}
+
+void BackgroundMultiuserLogger::writeToLog(juce::StringRef message)
 {
     auto* logger = BackgroundMultiuserLogger::getInstance();
     logger->writeToLogInternal(message);
 }
 
-void BackgroundMultiuserLogger::writeToLogInternal(const juce::String& message)
+void BackgroundMultiuserLogger::writeToLogInternal(juce::StringRef message)
 {
     /*
      you must call BML::getInstance()->configure(...) before you can start using the logger!!
@@ -69,72 +262,115 @@ void BackgroundMultiuserLogger::writeToLogInternal(const juce::String& message)
     if( isConfigured == false )
         return;
     
-    auto timestamp = juce::Time::getMillisecondCounterHiRes() - startTime;
-    const juce::ScopedLock lock(indexesLock);
-    auto producerIterator = getOrCreateProducer();
-    
-    jassert(producerIterator != producerIndexes.end() );
-    jassert(producerIterator->second != nullptr);
-    
-    auto str = createMessageWithThreadName(message, producerIterator);
+    auto timestamp = LogClock::now();
+    withDetailsForCurrentThread([&](ProducingThreadDetails& details)
+    {
+        enqueue(details, timestamp, LogRecord(details.getName(), details.getArena(), message));
+    });
+}
+
+BackgroundMultiuserLogger::CachedDetails& BackgroundMultiuserLogger::getCacheForCurrentThread()
+{
+    thread_local CachedDetails cache;
+    return cache;
+}
+
+BackgroundMultiuserLogger::CachedDetails::~CachedDetails()
+{
+    if( details == nullptr )
+        return;
     
-    log(producerIterator->second->getIndex(), timestamp, str);
+    //only the logger that the details came from can retire them, if it isn't being destroyed
+    auto& liveLoggers = getLiveLoggers();
+    const juce::ScopedLock lock(liveLoggers.lock);
+    if( auto it = liveLoggers.loggers.find(loggerID); it != liveLoggers.loggers.end() )
+    {
+        it->second->retireProducerForCurrentThread(*details);
+    }
 }
 
-BackgroundMultiuserLogger::Map::iterator BackgroundMultiuserLogger::getOrCreateProducer()
+void BackgroundMultiuserLogger::retireProducerForCurrentThread(ProducingThreadDetails& details)
 {
     const juce::ScopedLock lock(indexesLock);
-    
-    if( isThisAJuceThread() )
+    auto it = getEntryInMapForCurrentThread();
+    if( it != producerIndexes.end() && it->second.get() == &details )
+    {
+        retireProducer(it);
+    }
+}
+
+void BackgroundMultiuserLogger::retireProducer(iterator producerIterator)
+{
+    //the consumer drains what was pushed before this, and then gives the slot to the next producer that's created
+    producerIterator->second->getProducer().release();
+    retiredProducers.push_back(std::move(producerIterator->second));
+    producerIndexes.erase(producerIterator);
+}
+
+void BackgroundMultiuserLogger::collectDrainedProducers()
+{
+    const juce::ScopedLock lock(indexesLock);
+    for( auto it = retiredProducers.begin(); it != retiredProducers.end(); )
     {
-        //do we have a producer for this thread yet?
-        auto it = getEntryInMapForCurrentThread();
-        if( it != producerIndexes.end() )
+        if( mpscFifo->isRetiredAndDrained((*it)->getProducerID()) )
         {
-            return it;
+            drainedProducers.push_back(std::move(*it));
+            it = retiredProducers.erase(it);
+        }
+        else
+        {
+            ++it;
         }
-        
-        /*
-         from juce::Thread::getCurrentThread() docs:
-         Note that the main UI thread (or other non-JUCE threads) don't have a Thread
-         object associated with them, so this will return nullptr.
-         
-         it's ok if we pass in nullptr to createProducerIndexForCurrentThread though.
-         */
-        auto currentThread = juce::Thread::getCurrentThread();
-        return createProducerForCurrentThread(currentThread);
     }
+}
+
+juce::uint64 BackgroundMultiuserLogger::getNextLoggerID()
+{
+    //starts at 1, so an empty cache never matches a logger
+    static std::atomic<juce::uint64> nextID { 1 };
+    return nextID.fetch_add(1, std::memory_order_relaxed);
+}
+
+BackgroundMultiuserLogger::Map::iterator BackgroundMultiuserLogger::getOrCreateProducer()
+{
+    const juce::ScopedLock lock(indexesLock);
     
     /*
-     it's some other thread type
-     use a fallback with an invalid juce::ThreadID.
-     if no producer exists for this other thread, make one.
+     a thread only gets here on its first message, so a producer that's already in the map belongs to a thread that has exited without retiring it, and whose ID has been reused by this one.
+     That producer is retired, so this thread gets one of its own, and is logged under its own name.
      */
-    auto fallbackID = juce::Thread::ThreadID { nullptr };
-    
-    //do we have a producer yet?
-    auto fallbackIT = producerIndexes.find(fallbackID);
-    if( fallbackIT == producerIndexes.end() )
+    auto it = getEntryInMapForCurrentThread();
+    if( it != producerIndexes.end() )
     {
-        auto newProducerIndex = mpscFifo->createProducer();
-        
-        return addProducerIndexEntry(fallbackID, newProducerIndex, nullptr);
+        retireProducer(it);
     }
     
-    return fallbackIT;
+    /*
+     from juce::Thread::getCurrentThread() docs:
+     Note that the main UI thread (or other non-JUCE threads) don't have a Thread
+     object associated with them, so this will return nullptr.
+     
+     it's ok if we pass in nullptr to createProducerIndexForCurrentThread though.
+     Those threads still get a producer of their own, as every producer's fifo must only ever be pushed to by one thread.
+     */
+    auto currentThread = juce::Thread::getCurrentThread();
+    return createProducerForCurrentThread(currentThread);
 }
 
-bool BackgroundMultiuserLogger::isThisAJuceThread()
+juce::String BackgroundMultiuserLogger::getNameOfCurrentThread()
 {
-    if( juce::MessageManager::existsAndIsCurrentThread() )
-        return true;
-    
-    if( auto currentThread = juce::Thread::getCurrentThread() )
-        return true;
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+    //the longest name linux allows is 16 bytes, and macOS allows 64
+    char name[64] {};
+    if( pthread_getname_np(pthread_self(), name, sizeof(name)) == 0 && name[0] != '\0' )
+    {
+        return juce::String::fromUTF8(name);
+    }
+#endif
     
-    return false;
+    return "Anonymous Thread";
 }
-    
+
 BackgroundMultiuserLogger::Map::iterator BackgroundMultiuserLogger::getEntryInMapForCurrentThread()
 {
     auto currentThreadID = juce::Thread::getCurrentThreadId();
@@ -142,12 +378,12 @@ BackgroundMultiuserLogger::Map::iterator BackgroundMultiuserLogger::getEntryInMa
     return producerIndexes.find(currentThreadID);
 }
 
-BackgroundMultiuserLogger::Map::iterator BackgroundMultiuserLogger::addProducerIndexEntry(juce::Thread::ThreadID id,
-                                                      size_t producerIndex,
-                                                      juce::Thread *thread)
+BackgroundMultiuserLogger::Map::iterator BackgroundMultiuserLogger::addProducerEntry(juce::Thread::ThreadID id,
+                                                                                 TimedMPSCFifo::Producer producer,
+                                                                                 juce::Thread *thread)
 {
     const juce::ScopedLock lock(indexesLock);
-    auto [it, result] = producerIndexes.emplace(id, std::make_unique<ProducingThreadDetails>(producerIndex, thread));
+    auto [it, result] = producerIndexes.emplace(id, std::make_unique<ProducingThreadDetails>(std::move(producer), thread));
     jassert( result != false );
     juce::ignoreUnused(result);
     return it;
@@ -155,42 +391,26 @@ BackgroundMultiuserLogger::Map::iterator BackgroundMultiuserLogger::addProducerI
 
 BackgroundMultiuserLogger::Map::iterator BackgroundMultiuserLogger::createProducerForCurrentThread(juce::Thread* thread)
 {
-    return addProducerIndexEntry(juce::Thread::getCurrentThreadId(),
-                                 mpscFifo->createProducer(),
-                                 thread);
+    //every thread that logs can run the emergency drain, even one that overflows its stack, whether or not the drain has been installed yet
+    EmergencyLogDrain::installAlternateStackForCurrentThread();
+    
+    return addProducerEntry(juce::Thread::getCurrentThreadId(),
+                            mpscFifo->createProducer(),
+                            thread);
 }
 
-juce::String BackgroundMultiuserLogger::createMessageWithThreadName(juce::String message, iterator it)
+void BackgroundMultiuserLogger::enqueue(ProducingThreadDetails& details,
+                                        LogClock::Ticks timestamp,
+                                        const LogRecord& record)
 {
-    juce::String str;
-    str << "[";
+    jassert(mpscFifo != nullptr && isConfigured );
     
+    if( crashRing != nullptr )
     {
-        const juce::ScopedLock lock(indexesLock);
-        if( it != producerIndexes.end() && it->second != nullptr )
-        {
-            str << it->second->getName();
-        }
-        else
-        {
-            str << "unknown threadName";
-        }
+        crashRing->write(details.getName(), timestamp, record);
     }
     
-    str << "]: ";
-    
-    str << message;
-    
-    return str;
-}
-
-void BackgroundMultiuserLogger::log(size_t producerIndex,
-                                    double timestamp,
-                                    juce::String str)
-{
-    jassert(mpscFifo != nullptr && isConfigured );
-    
-    auto logResult = mpscFifo->add({timestamp, str}, producerIndex);
+    auto logResult = details.getProducer().push({timestamp, record});
     jassert(logResult == true); //if this fails, the ProducerCapacity parameter of the MPSCFifo is too small.
     juce::ignoreUnused(logResult);
 }
@@ -201,25 +421,150 @@ void BackgroundMultiuserLogger::printAllRemainingMessages()
         instance->flushMessagesFromFifo();
 }
 
+void BackgroundMultiuserLogger::addSink(std::unique_ptr<LogSink> sink, OverflowOptions overflowOptions)
+{
+    auto* instance = getInstance();
+    
+    const juce::ScopedLock lock(instance->writerLock);
+    jassert(instance->fileLogger != nullptr); //call configure() first!
+    if( instance->fileLogger != nullptr )
+    {
+        instance->fileLogger->addSink(std::move(sink), overflowOptions);
+    }
+}
+
+void BackgroundMultiuserLogger::installEmergencyDrain(EmergencyDrainOptions options)
+{
+    auto* instance = getInstance();
+    jassert(instance->mpscFifo != nullptr); //call configure() first!
+    if( instance->mpscFifo == nullptr )
+    {
+        return;
+    }
+    
+    //the old drain has to be uninstalled before the new one can be
+    instance->emergencyDrain.reset();
+    instance->emergencyDrain = std::make_unique<EmergencyLogDrain>(instance->getLogFile().withFileExtension(".bmdump"),
+                                                                   options,
+                                                                   &BackgroundMultiuserLogger::drainForCrash);
+}
+
+//this runs in a signal handler, so it can't lock, allocate or format anything.
+void BackgroundMultiuserLogger::drainForCrash(int fileDescriptor)
+{
+    auto* instance = getInstanceWithoutCreating();
+    if( instance == nullptr || instance->mpscFifo == nullptr )
+    {
+        return;
+    }
+    
+    const auto& fifo = *instance->mpscFifo;
+    
+    //the header says how many slots follow, so count them first
+    size_t numWaiting = 0;
+    fifo.peekAll([&numWaiting](const auto&) { ++numWaiting; });
+    
+    alignas(8) char slot[EmergencySlotSize];
+    static_assert(EmergencySlotSize >= MappedRingLog::HeaderSize);
+    
+    //the slots are written per producer, not in the order they were logged, so recovery has to sort them by time
+    MappedRingLog::writeHeader(slot, numWaiting, EmergencySlotSize, instance->withTS == MessageTimestampOptions::Show, true, instance->clock);
+    EmergencyLogDrain::writeAll(fileDescriptor, slot, MappedRingLog::HeaderSize);
+    
+    size_t numWritten = 0;
+    fifo.peekAll([&](const auto& message)
+    {
+        //the other threads may still be logging
+        if( numWritten == numWaiting )
+            return;
+        
+        MappedRingLog::encodeSlot(slot, EmergencySlotSize, numWritten, message.timeOfCreation, message.item);
+        EmergencyLogDrain::writeAll(fileDescriptor, slot, EmergencySlotSize);
+        ++numWritten;
+    });
+    
+    //or draining, so pad out with empty slots, to keep the file as long as its header says
+    std::memset(slot, 0, EmergencySlotSize);
+    for( ; numWritten < numWaiting; ++numWritten )
+    {
+        EmergencyLogDrain::writeAll(fileDescriptor, slot, EmergencySlotSize);
+    }
+}
+
 void BackgroundMultiuserLogger::flushMessagesFromFifo()
 {
+    const juce::ScopedLock lock(writerLock);
+    
     if( mpscFifo)
     {
         mpscFifo->flushAllToConsumerFifo();
         
+        //the last messages of these producers are now in the consumer fifo, and are written out below
+        collectDrainedProducers();
+        
+        //render the whole batch into one block, so it reaches the log file in a single write.
+        batchText.reset();
+        batchBinary.reset();
+        batchJson.clear();
+        
+        //a binary or JSON log only needs the text for the other sinks
+        auto formatAsText = (binaryLog == nullptr && jsonLog == nullptr) || (fileLogger != nullptr && fileLogger->hasSinks());
+        
+        if( jsonLog != nullptr )
+        {
+            jsonLog->rotateIfNeeded();
+        }
+        
+        //each binary log file has to be decodable on its own, so a rotated-in file starts with a header, the clock's start time and an empty dictionary.
+        if( binaryLog != nullptr && binaryLog->rotateIfNeeded() )
+        {
+            binaryEncoder = {};
+            BinaryLogEncoder::writeHeader(batchBinary, withTS == MessageTimestampOptions::Show);
+            BinaryLogEncoder::writeBanner(batchBinary, clock.getStartTimeMillis(), {});
+        }
+        
         decltype(mpscFifo)::element_type::ItemType message;
         while (mpscFifo->pull(message))
         {
-            juce::String str;
+            if( binaryLog != nullptr )
+            {
+                binaryEncoder.writeRecord(batchBinary, clock.toNanoseconds(message.timeOfCreation), message.item);
+            }
+            
+            if( jsonLog != nullptr )
+            {
+                appendAsJson(batchJson, message.timeOfCreation, message.item);
+            }
             
-            if( withTS == MessageTimestampOptions::Show )
+            if( formatAsText )
             {
-                str << juce::String::formatted("%f", message.timeOfCreation) << ": ";
-                //            str << message.timeOfCreation << ": ";
+                appendAsText(batchText, message.timeOfCreation, message.item);
             }
             
-            str << message.item;
-            juce::Logger::writeToLog(str);
+            message.item.releaseArenaSpace();
+        }
+        
+        //nothing points to these names or arenas any more. A new thread's name could be given the same address, so the encoder has to forget them.
+        for( auto& details : drainedProducers )
+        {
+            binaryEncoder.forgetThreadName(details->getName());
+        }
+        
+        drainedProducers.clear();
+        
+        if( binaryLog != nullptr )
+        {
+            binaryLog->writeBatch(static_cast<const char*>(batchBinary.getData()), batchBinary.getDataSize());
+        }
+        
+        if( jsonLog != nullptr && batchJson.empty() == false )
+        {
+            jsonLog->writeBatch(batchJson.data(), batchJson.size());
+        }
+        
+        if( fileLogger != nullptr && batchText.getDataSize() > 0 )
+        {
+            fileLogger->logBatch(static_cast<const char*>(batchText.getData()), batchText.getDataSize());
         }
     }
     else
@@ -228,4 +573,128 @@ void BackgroundMultiuserLogger::flushMessagesFromFifo()
     }
 }
 
+void BackgroundMultiuserLogger::appendAsText(juce::MemoryOutputStream& text,
+                                             LogClock::Ticks timeOfCreation,
+                                             const LogRecord& record)
+{
+    if( withTS == MessageTimestampOptions::Show )
+    {
+        LogClock::writeMilliseconds(text, clock.toNanoseconds(timeOfCreation));
+        text << ": ";
+    }
+    
+    text << "[" << record.getThreadName() << "]: ";
+    
+    if( record.hasLevel() )
+    {
+        text << getLogLevelName(record.getLevel()) << " [" << LogCategory::getName(record.getCategoryID()) << "] ";
+    }
+    
+    //the message is copied straight into the batch, rather than into a juce::String first
+    if( record.isDeferred() )
+    {
+        messageText.clear();
+        LogArguments::format(messageText, record.getFormatString(), record.getData(), record.getNumBytes());
+        text.write(messageText.data(), messageText.size());
+    }
+    else
+    {
+        text.write(record.getData(), record.getNumBytes());
+    }
+    
+    text << juce::newLine;
+}
+
+void BackgroundMultiuserLogger::appendAsJson(std::string& json,
+                                             LogClock::Ticks timeOfCreation,
+                                             const LogRecord& record)
+{
+    json += '{';
+    
+    if( withTS == MessageTimestampOptions::Show )
+    {
+        char timestamp[LogClock::MaxTimestampLength];
+        json += "\"time_ms\":";
+        json.append(timestamp, LogClock::formatMilliseconds(clock.toNanoseconds(timeOfCreation), timestamp, 1));
+        json += ',';
+    }
+    
+    const auto& threadName = record.getThreadName();
+    json += "\"thread\":";
+    LogArguments::appendJsonString(json, std::string_view(threadName.toRawUTF8(), threadName.getNumBytesAsUTF8()));
+    
+    if( record.hasLevel() )
+    {
+        json += ",\"level\":\"";
+        json += getLogLevelName(record.getLevel());
+        json += "\",\"category\":";
+        
+        auto* categoryName = LogCategory::getName(record.getCategoryID());
+        LogArguments::appendJsonString(json, categoryName != nullptr ? categoryName : "");
+    }
+    
+    json += ",\"message\":";
+    if( record.isStructured() )
+    {
+        LogArguments::appendJsonString(json, record.getFormatString());
+        json += ",\"fields\":{";
+        LogArguments::appendJsonFields(json, record.getData(), record.getNumBytes());
+        json += '}';
+    }
+    else if( record.isDeferred() )
+    {
+        messageText.clear();
+        LogArguments::format(messageText, record.getFormatString(), record.getData(), record.getNumBytes());
+        LogArguments::appendJsonString(json, messageText);
+    }
+    else
+    {
+        LogArguments::appendJsonString(json, std::string_view(record.getData(), record.getNumBytes()));
+    }
+    
+    if( record.isTruncated() )
+    {
+        json += ",\"truncated\":true";
+    }
+    
+    json += "}\n";
+}
+
+juce::String BackgroundMultiuserLogger::createBanner(const juce::String& welcomeMessage)
+{
+    //the same banner juce::FileLogger starts a text log with
+    juce::String banner;
+    banner << juce::newLine
+           << "**********************************************************" << juce::newLine
+           << welcomeMessage << juce::newLine
+           << "Log started: " << juce::Time::getCurrentTime().toString(true, true);
+    return banner;
+}
+
+juce::File BackgroundMultiuserLogger::createLogFile(const juce::String& extension)
+{
+    //named like the text log from juce::FileLogger::createDateStampedLogger()
+    auto file = juce::FileLogger::getSystemLogFileFolder()
+                    .getChildFile(ProjectInfo::projectName)
+                    .getChildFile("session" + juce::Time::getCurrentTime().formatted("%Y-%m-%d_%H-%M-%S"))
+                    .withFileExtension(extension)
+                    .getNonexistentSibling();
+    
+    auto result = file.create();
+    jassert(result.wasOk());
+    juce::ignoreUnused(result);
+    return file;
+}
+
+const juce::File& BackgroundMultiuserLogger::getLogFile() const
+{
+    if( binaryLog != nullptr )
+        return binaryLog->getFile();
+    
+    if( jsonLog != nullptr )
+        return jsonLog->getFile();
+    
+    return fileLogger->getLogFile();
+}
+
 JUCE_IMPLEMENT_SINGLETON (BackgroundMultiuserLogger)
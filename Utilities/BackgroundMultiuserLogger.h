@@ -14,7 +14,14 @@
 #include "MultiProducerSingleConsumerFifo.h"
 
 #include "TimerRunner.h"
+#include "ThreadRunner.h"
 #include "LoggerWithOptionalCout.h"
+#include "LogRecord.h"
+#include "BinaryLogFormat.h"
+#include "MappedRingLog.h"
+#include "LogClock.h"
+#include "EmergencyLogDrain.h"
+#include "LogRateLimiter.h"
 
 
 /**
@@ -24,19 +31,51 @@
  The wrapper class achieves this by using a `MultiProducerSingleConsumerFifo<T>` for collecting messages, that owns `Producer Fifo<T>` instances.
  
  A `Key-Value` `unordered_map` is used to coordinate collection of messages and sending them to the correct Producer fifo.
- The `Key` is the calling thread's `threadID`.
- The `Value` in the map is the index of the `Producer` in the `MPSCFifo`'s list of `Producer Fifo<T>`s
+ The `Key` is the calling thread's `threadID`, which every thread has, whether it's a `juce::Thread`, the message thread, a `std::thread`, or a callback thread from an audio driver or network library.
+ The `Value` in the map holds the `Producer` handle that was created for that thread by the `MPSCFifo`
  
  If the `Key` (`threadID`) doesn't exist in the map, a `Producer` is automatically created.
- when you call `writeToLog(message)`, the `message` is timestamped and added to that Producer's fifo.
+ The map is only consulted on a thread's first message. After that, the thread finds its `Producer` in a `thread_local` cache, without taking a lock.
+ When the thread exits, that cache retires its `Producer` and removes it from the map, so the `MPSCFifo`'s slot can be reused by another thread.
+ The thread's name and `LogArena` are kept until the messages it logged before exiting have been written out.
+ when you call `writeToLog(message)`, the `message` is timestamped and copied into a `LogRecord` in that Producer's fifo.
+ Once a thread has its Producer, logging doesn't allocate: short messages fit in the `LogRecord` itself, and longer ones go in the Producer's `LogArena`.
+ The thread's name is only added to the message when it is written to the log file.
+ 
+ `log(format, args...)` defers the formatting too: only the format string's pointer and a copy of the arguments are queued, and the message is formatted by the logger's background thread when it is written out.
+ ex: `BML::log("buffer %d took %.2f ms", bufferIndex, elapsedMs);`
+ 
+ `BML_LOG(level, category, format, args...)` does the same for a `LogLevel` in a `LogCategory`.
+ Levels below `BML_MINIMUM_LOG_LEVEL` are compiled out, and the rest are skipped, without evaluating the arguments, if the category's level is higher.
+ ex: `BML_LOG(Debug, audioLog, "buffer %d took %.2f ms", bufferIndex, elapsedMs);`
+ 
+ `logFields(message, fields...)` and `BML_LOG_FIELDS` log a message with named, typed fields, which are queued in the same binary form as `log()`'s arguments.
+ ex: `BML_LOG_FIELDS(Info, audioLog, "buffer processed", logField("index", bufferIndex), logField("ms", elapsedMs));`
+ With `LogFileFormat::JsonLines`, each message is written as a JSON object on its own line, with the fields as members of its "fields" object, so tools can read them without parsing the text.
+ A text log shows the fields after the message instead, as `index=12 ms=0.53`.
  
  A `TimerRunner` object periodically tells the `MPSCFifo` to retrieve all messages from each `Producer Fifo<T>`, sort them by their timestamp, and then pass then to the `MPSCFifo`'s `SingleConsumer` `Fifo<T>`.
- Then, all messages in the SingleConsumer fifo are passed to the `juce::FileLogger` instance and written to the log file.
+ Then, all messages in the SingleConsumer fifo are formatted into one block of text, which is written to the log file in a single write.
+ How durable each of those writes is depends on the `WriteDurability` passed to `configure()`.
+ The `LogRotationOptions` passed to `configure()` can limit how big or old the log file gets. Full files are rotated out between batches, and compressed on a background thread.
+ 
+ Messages that are still waiting in the fifos are lost if the process crashes. Pass `CrashRingOptions` to `configure()` to also copy every message into a `MappedRingLog` as it is logged.
+ The ring sits next to the log file, with a `.bmring` extension, and is deleted when the logger is, so finding one means the process that wrote it crashed.
+ The RingLogRecovery tool turns it back into text.
+ 
+ With `LogFileFormat::Binary`, the messages aren't formatted at all. The records are written to a `.bmlog` file in the `BinaryLogFormat`,
+ which the BinaryLogDecoder tool turns back into the text the log file would have held.
+ Messages logged with `juce::Logger::writeToLog()` by other code aren't written to a binary log.
+ 
+ The `TimerRunner` runs on the message thread, so the sorting and file I/O do too, and nothing is written in a process that doesn't run a message loop.
+ Pass `WriterThreadOptions::BackgroundThread` to `configure()` to do that work on a dedicated writer thread instead.
+ The writer thread sleeps until a thread logs a message, so it costs nothing while nobody is logging.
  
  Be sure to call `configure()` before you start logging messages!
  
  Helper functions:
  - `printAllRemainingMessages()` which flushes the `MSPCFifo` to the FileLogger
+ - `addSink()` which sends the messages somewhere else as well: std::cerr, a UDP port, an in-memory ring...
  */
 
 struct BackgroundMultiuserLogger
@@ -57,14 +96,118 @@ struct BackgroundMultiuserLogger
         Hide
     };
     
+    enum class WriterThreadOptions
+    {
+        MessageThreadTimer,
+        BackgroundThread
+    };
+    
+    /**
+     - `Text`: the "session<date>.log" file from `juce::FileLogger`.
+     - `Binary`: a ".bmlog" file in the `BinaryLogFormat`.
+     - `JsonLines`: a ".jsonl" file with one JSON object per message: `{"time_ms":12.5,"thread":"Audio","level":"INFO","category":"Audio","message":"...","fields":{...}}`
+       "time_ms" is only there when timestamps are shown, and "level" and "category" only for messages logged to a category.
+     */
+    enum class LogFileFormat
+    {
+        Text,
+        Binary,
+        JsonLines
+    };
+    
+    /**
+     The writer and crash ring options only take effect the first time `configure()` is called.
+     `writerPriority` is only used with `WriterThreadOptions::BackgroundThread`.
+     */
     void configure(LoggerWithOptionalCout::LogOptions alsoLogToCout, 
                    RevealOptions revealLogFileOnExit,
-                   MessageTimestampOptions withTimestamp);
+                   MessageTimestampOptions withTimestamp,
+                   WriterThreadOptions writerThreadOptions = WriterThreadOptions::MessageThreadTimer,
+                   juce::Thread::Priority writerPriority = juce::Thread::Priority::low,
+                   WriteDurability durability = WriteDurability::FlushPerBatch,
+                   LogFileFormat fileFormat = LogFileFormat::Text,
+                   LogRotationOptions rotation = {},
+                   CrashRingOptions crashRing = {});
+    
+    static void writeToLog(juce::StringRef message);
+    
+    /**
+     Logs a printf-style message without formatting it on the calling thread.
+     `format` isn't copied, so it must be a string literal.
+     Numbers, enums, bools and pointers are copied as they are. `juce::String` and `const char*` arguments have their characters copied.
+     */
+    template<typename ... Args>
+    requires (IsDeferredLogArgument<std::decay_t<Args>> && ...)
+    static void log(const char* format, const Args& ... args)
+    {
+        auto* logger = BackgroundMultiuserLogger::getInstance();
+        logger->logInternal(nullptr, LogLevel::Info, format, args...);
+    }
     
-    static void writeToLog(const juce::String& message);
+    /**
+     Like `log(format, args...)`, but the message is tagged with `level` and `category`.
+     This doesn't check whether `level` is enabled. Use `BML_LOG`, which checks before the arguments are even evaluated.
+     */
+    template<typename ... Args>
+    requires (IsDeferredLogArgument<std::decay_t<Args>> && ...)
+    static void log(const LogCategory& category, LogLevel level, const char* format, const Args& ... args)
+    {
+        auto* logger = BackgroundMultiuserLogger::getInstance();
+        logger->logInternal(&category, level, format, args...);
+    }
+    
+    /**
+     Like `log(category, level, format, args...)`, for a message that a rate limited or sampled `callSite` let through. Use `BML_LOG_RATE_LIMITED` or `BML_LOG_SAMPLED`.
+     The messages the call site suppresses are reported once a second, with a line saying how many, see `LogCallSite`.
+     */
+    template<typename ... Args>
+    requires (IsDeferredLogArgument<std::decay_t<Args>> && ...)
+    static void logLimited(LogCallSite& callSite, const LogCategory& category, LogLevel level, const char* format, const Args& ... args)
+    {
+        callSite.rememberStatement(category, level, format);
+        log(category, level, format, args...);
+    }
+    
+    /**
+     Logs `message` with named fields, ex: `BML::logFields("request finished", logField("status", 200), logField("path", url));`
+     The values are copied like `log()`'s arguments. The keys are copied too, but `message` isn't, so it must be a string literal. It isn't formatted either, so it can contain '%'.
+     */
+    template<typename ... Fields>
+    requires (IsLogField<Fields> && ...)
+    static void logFields(const char* message, const Fields& ... fields)
+    {
+        auto* logger = BackgroundMultiuserLogger::getInstance();
+        logger->logFieldsInternal(nullptr, LogLevel::Info, message, fields...);
+    }
+    
+    //Like `logFields(message, fields...)`, but the message is tagged with `level` and `category`. Use `BML_LOG_FIELDS`.
+    template<typename ... Fields>
+    requires (IsLogField<Fields> && ...)
+    static void logFields(const LogCategory& category, LogLevel level, const char* message, const Fields& ... fields)
+    {
+        auto* logger = BackgroundMultiuserLogger::getInstance();
+        logger->logFieldsInternal(&category, level, message, fields...);
+    }
     
     static void printAllRemainingMessages();
     
+    /**
+     Adds a sink that gets every message from now on, as text, with its own thread and queue. See `LoggerWithOptionalCout::addSink()`.
+     Call this after `configure()`. Calling `configure()` again starts over without it.
+     */
+    static void addSink(std::unique_ptr<LogSink> sink, OverflowOptions overflowOptions = {});
+    
+    /**
+     Saves the messages that are still waiting in the fifos when the process dies, which are the ones that explain why.
+     On a fatal signal or `std::terminate()`, every waiting message is written to a dump file next to the log file, with the extension ".bmdump", in the crash ring's format, so RingLogRecovery can read it.
+     Nothing is formatted while crashing: the fifos are walked without any locks, and each message is copied into a fixed-size slot on the stack and written with `write()`.
+     Messages longer than `EmergencySlotSize` are truncated.
+     Call this after `configure()`. The dump file is deleted on a clean exit, if nothing was written to it. See `EmergencyLogDrain`.
+     */
+    static void installEmergencyDrain(EmergencyDrainOptions options = {});
+    
+    static constexpr size_t EmergencySlotSize = 512;
+    
     JUCE_DECLARE_SINGLETON(BackgroundMultiuserLogger, false)
 private:
     RevealOptions revealOnExit = RevealOptions::DontRevealOnExit;
@@ -72,11 +215,28 @@ private:
     bool isConfigured = false;
     std::unique_ptr<LoggerWithOptionalCout> fileLogger;
     
+    //only used with LogFileFormat::Binary. The fileLogger then has no log file, and only routes the text to the other sinks.
+    std::unique_ptr<BatchedFileWriter> binaryLog;
+    BinaryLogEncoder binaryEncoder;
+    
+    //only used with LogFileFormat::JsonLines, in the same way
+    std::unique_ptr<BatchedFileWriter> jsonLog;
+    
+    //written to by the producers, as they log
+    std::unique_ptr<MappedRingLog> crashRing;
+    
+    std::unique_ptr<EmergencyLogDrain> emergencyDrain;
+    static void drainForCrash(int fileDescriptor);
+    
     juce::CriticalSection indexesLock;
     
+    static constexpr int MessageQueueSize = 10'000;
+    using TimedMPSCFifo = TimedItemMultiProducerSingleConsumerFifoDefaultSort<LogRecord, MessageQueueSize, MessageQueueSize * 4, LogClock::Ticks>;
+    std::unique_ptr<TimedMPSCFifo> mpscFifo;
+    
     struct ProducingThreadDetails
     {
-        ProducingThreadDetails(size_t index_, juce::Thread* thread) : index(index_)
+        ProducingThreadDetails(TimedMPSCFifo::Producer producer_, juce::Thread* thread) : producer(std::move(producer_)), producerID(producer.getID())
         {
             if( thread )
             {
@@ -88,15 +248,20 @@ private:
             }
             else
             {
-                threadName = "Anonymous Thread";
+                threadName = getNameOfCurrentThread();
             }
         }
         
-        size_t getIndex() const { return index; }
-        juce::String getName() const { return threadName; }
+        TimedMPSCFifo::Producer& getProducer() { return producer; }
+        TimedMPSCFifo::ProducerID getProducerID() const { return producerID; }
+        const juce::String& getName() const { return threadName; }
+        LogArena& getArena() { return arena; }
     private:
-        size_t index;
+        TimedMPSCFifo::Producer producer;
+        //kept after the producer is released, to tell when its last messages have been drained
+        TimedMPSCFifo::ProducerID producerID;
         juce::String threadName;
+        LogArena arena;
     };
     
     using Map = std::unordered_map<juce::Thread::ThreadID, std::unique_ptr<ProducingThreadDetails>>;
@@ -104,31 +269,211 @@ private:
     
     using iterator = Map::iterator;
     
-    static constexpr int MessageQueueSize = 10'000;
-    using TimedMPSCFifo = TimedItemMultiProducerSingleConsumerFifoDefaultSort<juce::String, MessageQueueSize>;
-    std::unique_ptr<TimedMPSCFifo> mpscFifo;
+    /*
+     the details of threads that have exited. They are kept until the consumer has drained their producers, as their messages still point to their names and arenas.
+     'retiredProducers' is guarded by 'indexesLock'. 'drainedProducers' is only used inside flushMessagesFromFifo().
+     */
+    std::vector<std::unique_ptr<ProducingThreadDetails>> retiredProducers;
+    std::vector<std::unique_ptr<ProducingThreadDetails>> drainedProducers;
+    
+    void retireProducer(iterator producerIterator);
+    void retireProducerForCurrentThread(ProducingThreadDetails& details);
+    void collectDrainedProducers();
     
     std::unique_ptr<TimerRunner<BackgroundMultiuserLogger, 25>> messagePurger;
+    std::unique_ptr<ThreadRunner<BackgroundMultiuserLogger>> writerThread;
+    
+    //logs how many messages each rate limited or sampled call site has suppressed, whichever way the messages are written
+    std::unique_ptr<TimerRunner<BackgroundMultiuserLogger, 1000>> suppressionReporter;
+    void reportSuppressedMessages();
+    
+    //serializes flushMessagesFromFifo(), which can be called from the writer thread and from printAllRemainingMessages() at the same time.
+    juce::CriticalSection writerLock;
+    
+    //each flush's messages are formatted into these, and written to the log file as one batch. They are reset, but never shrunk, between flushes.
+    juce::MemoryOutputStream batchText;
+    juce::MemoryOutputStream batchBinary;
+    std::string batchJson;
+    
+    //deferred messages are formatted into this, before being copied into the batch
+    std::string messageText;
     
-    void writeToLogInternal(const juce::String& message);
+    void writeToLogInternal(juce::StringRef message);
+    
+    void startWriting(WriterThreadOptions writerThreadOptions, juce::Thread::Priority writerPriority);
+    void stopWriting();
+    
+    bool canRunWriterThread() { return true; }
+    void writeOnBackgroundThread(juce::Thread& thread);
     
     void flushMessagesFromFifo();
+    void appendAsText(juce::MemoryOutputStream& text, LogClock::Ticks timeOfCreation, const LogRecord& record);
+    void appendAsJson(std::string& json, LogClock::Ticks timeOfCreation, const LogRecord& record);
+    
+    static juce::String createBanner(const juce::String& welcomeMessage);
+    static juce::File createLogFile(const juce::String& extension);
+    const juce::File& getLogFile() const;
+    
+    template<typename ... Args>
+    void logInternal(const LogCategory* category, LogLevel level, const char* format, const Args& ... args)
+    {
+        enqueueNewRecord(category, level, [&](ProducingThreadDetails& details)
+        {
+            return LogRecord::createDeferred(details.getName(), details.getArena(), format, args...);
+        });
+    }
+    
+    template<typename ... Fields>
+    void logFieldsInternal(const LogCategory* category, LogLevel level, const char* message, const Fields& ... fields)
+    {
+        enqueueNewRecord(category, level, [&](ProducingThreadDetails& details)
+        {
+            return LogRecord::createStructured(details.getName(), details.getArena(), message, fields...);
+        });
+    }
+    
+    template<typename CreateRecord>
+    void enqueueNewRecord(const LogCategory* category, LogLevel level, CreateRecord&& createRecord)
+    {
+        //you must call BML::getInstance()->configure(...) before you can start using the logger!!
+        jassert(isConfigured);
+        if( isConfigured == false )
+            return;
+        
+        auto timestamp = LogClock::now();
+        withDetailsForCurrentThread([&](ProducingThreadDetails& details)
+        {
+            auto record = createRecord(details);
+            if( category != nullptr )
+            {
+                record.setLevel(level, category->getID());
+            }
+            
+            enqueue(details, timestamp, record);
+        });
+    }
     
-    juce::String createMessageWithThreadName(juce::String str, iterator producerIterator);
-    void log(size_t producerIndex,
-             double timestamp,
-             juce::String str);
+    /**
+     Each thread caches its ProducingThreadDetails after its first message, so that later messages skip 'indexesLock' and the map.
+     The cache remembers which logger it belongs to, so a thread never uses details left over from a logger that has since been destroyed.
+     It's destroyed when its thread exits, and retires the thread's producer, unless its logger has started being destroyed.
+     */
+    struct CachedDetails
+    {
+        ~CachedDetails();
+        
+        juce::uint64 loggerID = 0;
+        ProducingThreadDetails* details = nullptr;
+    };
     
-    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    static CachedDetails& getCacheForCurrentThread();
+    static juce::uint64 getNextLoggerID();
+    const juce::uint64 loggerID = getNextLoggerID();
+    
+    template<typename Callback>
+    void withDetailsForCurrentThread(Callback&& callback)
+    {
+        auto& cache = getCacheForCurrentThread();
+        if( cache.loggerID == loggerID )
+        {
+            callback(*cache.details);
+            return;
+        }
+        
+        const juce::ScopedLock lock(indexesLock);
+        auto producerIterator = getOrCreateProducer();
+        
+        jassert(producerIterator != producerIndexes.end() );
+        jassert(producerIterator->second != nullptr);
+        
+        cache = { loggerID, producerIterator->second.get() };
+        callback(*producerIterator->second);
+    }
+    
+    void enqueue(ProducingThreadDetails& details,
+                 LogClock::Ticks timestamp,
+                 const LogRecord& record);
+    
+    //messages are timestamped in raw ticks, which are only converted to time since the logger started when they are written out
+    const LogClock clock;
     
     iterator getOrCreateProducer();
     iterator createProducerForCurrentThread(juce::Thread* thread);
     iterator getEntryInMapForCurrentThread();
     
-    static bool isThisAJuceThread();
-    iterator addProducerIndexEntry(juce::Thread::ThreadID id,
-                               size_t producerIndex,
-                               juce::Thread* thread);
+    //the name the OS knows a thread that isn't a juce::Thread by, ex: from std::thread or an audio driver's callback
+    static juce::String getNameOfCurrentThread();
+    iterator addProducerEntry(juce::Thread::ThreadID id,
+                              TimedMPSCFifo::Producer producer,
+                              juce::Thread* thread);
 };
 
 using BML = BackgroundMultiuserLogger;
+
+/**
+ Logs a message at `level`, a `LogLevel` without the `LogLevel::`, to `category`, a `LogCategory`.
+ Levels below `MinimumLogLevel` compile to nothing. Above it, the category's level is checked before the arguments are evaluated.
+ */
+#define BML_LOG(level, category, ...) \
+    do \
+    { \
+        if constexpr( LogLevel::level >= MinimumLogLevel ) \
+        { \
+            if( (category).isEnabled(LogLevel::level) ) \
+                BackgroundMultiuserLogger::log((category), LogLevel::level, __VA_ARGS__); \
+        } \
+    } while( false )
+
+/**
+ `BML_LOG`, for a statement that could log too often, ex: in a loop.
+ At most `messagesPerSecond` of its messages are logged on average, with bursts of up to `burst`. See `LogRateLimiter`.
+ The limiter is a static at the call site, so it's shared by every thread that runs the statement. Each thread counts the messages it suppressed in a thread_local.
+ How many were suppressed is logged once a second, for as long as there are any.
+ */
+#define BML_LOG_RATE_LIMITED(level, category, messagesPerSecond, burst, ...) \
+    do \
+    { \
+        if constexpr( LogLevel::level >= MinimumLogLevel ) \
+        { \
+            if( (category).isEnabled(LogLevel::level) ) \
+            { \
+                static LogRateLimiter bmlCallSiteLimiter { (messagesPerSecond), (burst) }; \
+                static thread_local LogLimiterThreadState bmlCallSiteThreadState; \
+                if( bmlCallSiteLimiter.tryAcquire(bmlCallSiteThreadState) ) \
+                    BackgroundMultiuserLogger::logLimited(bmlCallSiteLimiter, (category), LogLevel::level, __VA_ARGS__); \
+            } \
+        } \
+    } while( false )
+
+/**
+ `BML_LOG`, for a statement that could log too often, where 1 in every `oneInN` of its messages is enough. See `LogSampler`.
+ The sampler is a static at the call site, so it counts the calls from every thread that runs the statement together.
+ How many were suppressed is logged once a second, for as long as there are any.
+ */
+#define BML_LOG_SAMPLED(level, category, oneInN, ...) \
+    do \
+    { \
+        if constexpr( LogLevel::level >= MinimumLogLevel ) \
+        { \
+            if( (category).isEnabled(LogLevel::level) ) \
+            { \
+                static LogSampler bmlCallSiteSampler { (oneInN) }; \
+                if( bmlCallSiteSampler.tryAcquire() ) \
+                    BackgroundMultiuserLogger::logLimited(bmlCallSiteSampler, (category), LogLevel::level, __VA_ARGS__); \
+            } \
+        } \
+    } while( false )
+
+/**
+ `BML_LOG`, for a message with named fields. See `BackgroundMultiuserLogger::logFields()`.
+ ex: `BML_LOG_FIELDS(Warning, networkLog, "request failed", logField("status", status), logField("path", url));`
+ */
+#define BML_LOG_FIELDS(level, category, ...) \
+    do \
+    { \
+        if constexpr( LogLevel::level >= MinimumLogLevel ) \
+        { \
+            if( (category).isEnabled(LogLevel::level) ) \
+                BackgroundMultiuserLogger::logFields((category), LogLevel::level, __VA_ARGS__); \
+        } \
+    } while( false )
@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    BatchedFileWriter.cpp
+    Created: 16 Oct 2026 8:41:07pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#include "BatchedFileWriter.h"
+
+BatchedFileWriter::BatchedFileWriter(const juce::File& f, WriteDurability d, LogRotationOptions r) :
+file(f),
+durability(d),
+pending(CoalesceThreshold),
+rotation(r)
+{
+    openStream();
+    
+    if( rotation.isEnabled() )
+    {
+        archiver = std::make_unique<RotatedLogArchiver>(rotation.compression, rotation.maxNumRotatedFiles);
+    }
+}
+
+BatchedFileWriter::~BatchedFileWriter()
+{
+    writePending();
+    
+    if( openedOk() )
+    {
+        stream->flush();
+    }
+}
+
+void BatchedFileWriter::openStream()
+{
+    //FileOutputStream opens existing files positioned at the end, so batches are appended.
+    stream = std::make_unique<juce::FileOutputStream>(file, 0);
+    jassert(stream->openedOk());
+    
+    numBytesInFile = stream->getPosition();
+    fileStartTimeMs = juce::Time::currentTimeMillis();
+}
+
+bool BatchedFileWriter::openedOk() const
+{
+    return stream != nullptr && stream->openedOk();
+}
+
+void BatchedFileWriter::writeBatch(const char* data, size_t numBytes)
+{
+    if( numBytes == 0 )
+    {
+        return;
+    }
+    
+    if( durability == WriteDurability::None )
+    {
+        pending.write(data, numBytes);
+        if( pending.getDataSize() >= CoalesceThreshold )
+        {
+            writePending();
+        }
+        
+        return;
+    }
+    
+    write(data, numBytes);
+    
+    if( durability == WriteDurability::FsyncPerBatch && openedOk() )
+    {
+        //FileOutputStream::flush() syncs the file to the disk.
+        stream->flush();
+    }
+}
+
+bool BatchedFileWriter::rotateIfNeeded()
+{
+    if( archiver == nullptr )
+    {
+        return false;
+    }
+    
+    //batches still coalescing count too, as they are going into this file
+    auto numBytes = numBytesInFile + static_cast<juce::int64>(pending.getDataSize());
+    auto isFull = rotation.maxBytes > 0 && numBytes >= rotation.maxBytes;
+    auto isOld = rotation.maxAge.inMilliseconds() > 0
+                 && juce::Time::currentTimeMillis() - fileStartTimeMs >= rotation.maxAge.inMilliseconds();
+    
+    if( isFull == false && isOld == false )
+    {
+        return false;
+    }
+    
+    //an empty file has nothing worth keeping, even if it is old
+    if( numBytes == 0 )
+    {
+        fileStartTimeMs = juce::Time::currentTimeMillis();
+        return false;
+    }
+    
+    rotate();
+    return true;
+}
+
+void BatchedFileWriter::rotate()
+{
+    //whatever was coalescing belongs at the end of the file being rotated out
+    writePending();
+    stream.reset();
+    
+    auto rotatedFile = file.getSiblingFile(file.getFileNameWithoutExtension()
+                                           + "_" + juce::String(++numRotatedFiles).paddedLeft('0', 3)
+                                           + file.getFileExtension()).getNonexistentSibling();
+    
+    //renaming is atomic, so nothing in the file can go missing, and the archiver never sees it half written
+    if( file.moveFileTo(rotatedFile) )
+    {
+        archiver->add(rotatedFile);
+    }
+    else
+    {
+        jassertfalse; //carry on appending to the same file
+    }
+    
+    openStream();
+}
+
+void BatchedFileWriter::write(const char* data, size_t numBytes)
+{
+    if( openedOk() == false )
+    {
+        return;
+    }
+    
+    auto result = stream->write(data, numBytes);
+    jassert(result); //the disk is full, or the file has gone away
+    juce::ignoreUnused(result);
+    
+    numBytesInFile += static_cast<juce::int64>(numBytes);
+}
+
+void BatchedFileWriter::writePending()
+{
+    if( pending.getDataSize() == 0 )
+    {
+        return;
+    }
+    
+    write(static_cast<const char*>(pending.getData()), pending.getDataSize());
+    pending.reset();
+}
@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    BatchedFileWriter.h
+    Created: 16 Oct 2026 8:41:07pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RotatedLogArchiver.h"
+
+/**
+ How hard a `BatchedFileWriter` works to get each batch onto the disk.
+ 
+ - `None`: batches are collected in memory, and written once `CoalesceThreshold` bytes have built up, or when the writer is destroyed. The fewest syscalls, but the most to lose if the process crashes.
+ - `FlushPerBatch`: each batch is written to the file with a single `write()`. It survives the process crashing, but not the machine losing power.
+ - `FsyncPerBatch`: like `FlushPerBatch`, and the file is synced to the disk after each batch.
+ */
+enum class WriteDurability
+{
+    None,
+    FlushPerBatch,
+    FsyncPerBatch
+};
+
+/**
+ When a `BatchedFileWriter` moves the file it's writing to aside, and starts a new one.
+ 
+ The file is rotated before the next batch once it has reached `maxBytes`, or has been written to for longer than `maxAge`. A zero turns that limit off, and with both off, the file is never rotated.
+ Rotated files are renamed `<name>_001<.ext>`, `<name>_002<.ext>`, and so on, then handed to a `RotatedLogArchiver`, which compresses them and keeps only the newest `maxNumRotatedFiles` (0 keeps them all).
+ */
+struct LogRotationOptions
+{
+    juce::int64 maxBytes = 0;
+    juce::RelativeTime maxAge { 0.0 };
+    int maxNumRotatedFiles = 0;
+    RotatedFileCompression compression = RotatedFileCompression::GZip;
+    
+    bool isEnabled() const { return maxBytes > 0 || maxAge.inMilliseconds() > 0; }
+};
+
+/**
+ Appends batches of text to a file, keeping the file open between batches.
+ 
+ Unlike `juce::FileLogger`, which opens, appends to and flushes the file for every message,
+ a whole batch of messages is handed over in one block, and reaches the file in a single write.
+ 
+ Not thread safe. Only one thread may write at a time.
+ 
+ Rotation happens between batches, on the writing thread, when `rotateIfNeeded()` is called, so a batch never ends up split across two files.
+ The file is renamed and reopened rather than copied, so rotating costs a couple of syscalls. Everything slower happens on the archiver's thread.
+ */
+struct BatchedFileWriter
+{
+    static constexpr size_t CoalesceThreshold = 64 * 1024;
+    
+    BatchedFileWriter(const juce::File& file, WriteDurability durability, LogRotationOptions rotation = {});
+    
+    //writes out anything still pending
+    ~BatchedFileWriter();
+    
+    void writeBatch(const char* data, size_t numBytes);
+    
+    /**
+     Starts a new file if the current one has reached one of the rotation limits.
+     Call it before writing a batch. Returns true if the batch will be the first thing in a new file, so that anything that has to start every file, like a header, can be written first.
+     */
+    bool rotateIfNeeded();
+    
+    bool openedOk() const;
+    const juce::File& getFile() const { return file; }
+private:
+    juce::File file;
+    WriteDurability durability;
+    
+    //unbuffered, so every write() on it is a single write to the file
+    std::unique_ptr<juce::FileOutputStream> stream;
+    
+    //batches waiting to be written, with WriteDurability::None
+    juce::MemoryOutputStream pending;
+    
+    LogRotationOptions rotation;
+    juce::int64 numBytesInFile = 0;
+    juce::int64 fileStartTimeMs = 0;
+    int numRotatedFiles = 0;
+    std::unique_ptr<RotatedLogArchiver> archiver;
+    
+    void openStream();
+    void rotate();
+    void write(const char* data, size_t numBytes);
+    void writePending();
+    
+    JUCE_DECLARE_NON_COPYABLE(BatchedFileWriter)
+};
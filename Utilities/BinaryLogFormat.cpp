@@ -0,0 +1,315 @@
+/*
+  ==============================================================================
+
+    BinaryLogFormat.cpp
+    Created: 16 Oct 2026 9:37:12pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#include "BinaryLogFormat.h"
+
+namespace
+{
+    void writeVarint(juce::OutputStream& out, juce::uint64 value)
+    {
+        juce::uint8 bytes[10];
+        size_t numBytes = 0;
+        
+        while( value >= 0x80 )
+        {
+            bytes[numBytes++] = static_cast<juce::uint8>(value | 0x80);
+            value >>= 7;
+        }
+        
+        bytes[numBytes++] = static_cast<juce::uint8>(value);
+        out.write(bytes, numBytes);
+    }
+    
+    juce::uint64 zigzagEncode(juce::int64 value)
+    {
+        return (static_cast<juce::uint64>(value) << 1) ^ static_cast<juce::uint64>(value >> 63);
+    }
+    
+    juce::int64 zigzagDecode(juce::uint64 value)
+    {
+        return static_cast<juce::int64>(value >> 1) ^ -static_cast<juce::int64>(value & 1);
+    }
+    
+    void writeChunkType(juce::OutputStream& out, BinaryLogChunk type)
+    {
+        out.writeByte(static_cast<char>(type));
+    }
+    
+    void writeBytes(juce::OutputStream& out, const char* data, size_t numBytes)
+    {
+        writeVarint(out, numBytes);
+        out.write(data, numBytes);
+    }
+    
+    //reads chunks from the binary log. Every read fails, rather than going past the end, if the data ends part way through a chunk.
+    struct ChunkReader
+    {
+        const char* position;
+        const char* end;
+        
+        bool readVarint(juce::uint64& value)
+        {
+            value = 0;
+            for( int shift = 0; shift < 64; shift += 7 )
+            {
+                if( position == end )
+                    return false;
+                
+                auto byte = static_cast<juce::uint8>(*position++);
+                value |= static_cast<juce::uint64>(byte & 0x7F) << shift;
+                if( (byte & 0x80) == 0 )
+                    return true;
+            }
+            
+            return false;
+        }
+        
+        bool readBytes(const char*& data, size_t& numBytes)
+        {
+            juce::uint64 length = 0;
+            if( readVarint(length) == false || length > static_cast<juce::uint64>(end - position) )
+                return false;
+            
+            data = position;
+            numBytes = static_cast<size_t>(length);
+            position += numBytes;
+            return true;
+        }
+    };
+}
+
+//==============================================================================
+void BinaryLogEncoder::writeHeader(juce::OutputStream& out, bool showTimestamps)
+{
+    out.write(Magic, sizeof(Magic));
+    out.writeByte(static_cast<char>(showTimestamps ? ShowTimestampsFlag : 0));
+}
+
+void BinaryLogEncoder::writeBanner(juce::OutputStream& out, juce::int64 startTimeMillis, const juce::String& text)
+{
+    writeChunkType(out, BinaryLogChunk::Banner);
+    writeVarint(out, static_cast<juce::uint64>(std::max<juce::int64>(startTimeMillis, 0)));
+    writeBytes(out, text.toRawUTF8(), text.getNumBytesAsUTF8());
+}
+
+void BinaryLogEncoder::writeRecord(juce::OutputStream& out, juce::int64 timeOfCreationNs, const LogRecord& record)
+{
+    //the thread name and template have to be written before the record that refers to them
+    auto producerID = getProducerID(out, record.getThreadName());
+    auto templateID = record.isDeferred() ? getTemplateID(out, record.getFormatString()) : 0;
+    
+    if( record.hasLevel() )
+    {
+        writeCategoryIfNeeded(out, record.getCategoryID());
+        
+        writeChunkType(out, BinaryLogChunk::Level);
+        writeVarint(out, static_cast<juce::uint64>(record.getLevel()));
+        writeVarint(out, record.getCategoryID());
+    }
+    
+    //rounded to the nearest microsecond
+    auto timestamp = (timeOfCreationNs + 500) / 1000;
+    auto delta = timestamp - previousTimestampMicroseconds;
+    previousTimestampMicroseconds = timestamp;
+    
+    writeChunkType(out, record.isDeferred() ? BinaryLogChunk::Deferred : BinaryLogChunk::Text);
+    writeVarint(out, zigzagEncode(delta));
+    writeVarint(out, producerID);
+    
+    if( record.isDeferred() )
+    {
+        writeVarint(out, templateID);
+    }
+    
+    writeBytes(out, record.getData(), record.getNumBytes());
+}
+
+juce::uint32 BinaryLogEncoder::getProducerID(juce::OutputStream& out, const juce::String& threadName)
+{
+    if( auto it = producerIDs.find(&threadName); it != producerIDs.end() )
+    {
+        return it->second;
+    }
+    
+    auto id = nextProducerID++;
+    producerIDs.emplace(&threadName, id);
+    
+    writeChunkType(out, BinaryLogChunk::ThreadName);
+    writeVarint(out, id);
+    writeBytes(out, threadName.toRawUTF8(), threadName.getNumBytesAsUTF8());
+    return id;
+}
+
+void BinaryLogEncoder::forgetThreadName(const juce::String& threadName)
+{
+    producerIDs.erase(&threadName);
+}
+
+juce::uint32 BinaryLogEncoder::getTemplateID(juce::OutputStream& out, const char* formatString)
+{
+    if( auto it = templateIDs.find(formatString); it != templateIDs.end() )
+    {
+        return it->second;
+    }
+    
+    auto id = static_cast<juce::uint32>(templateIDs.size());
+    templateIDs.emplace(formatString, id);
+    
+    writeChunkType(out, BinaryLogChunk::Template);
+    writeVarint(out, id);
+    writeBytes(out, formatString, std::strlen(formatString));
+    return id;
+}
+
+void BinaryLogEncoder::writeCategoryIfNeeded(juce::OutputStream& out, juce::uint16 categoryID)
+{
+    if( writtenCategories.insert(categoryID).second == false )
+    {
+        return;
+    }
+    
+    auto* name = LogCategory::getName(categoryID);
+    if( name == nullptr )
+    {
+        name = "";
+    }
+    
+    writeChunkType(out, BinaryLogChunk::Category);
+    writeVarint(out, categoryID);
+    writeBytes(out, name, std::strlen(name));
+}
+
+//==============================================================================
+juce::Result BinaryLogDecoder::decode(const void* data, size_t numBytes, juce::OutputStream& out)
+{
+    constexpr auto headerSize = sizeof(BinaryLogEncoder::Magic) + 1;
+    if( numBytes < headerSize || std::memcmp(data, BinaryLogEncoder::Magic, sizeof(BinaryLogEncoder::Magic)) != 0 )
+    {
+        return juce::Result::fail("Not a binary log file");
+    }
+    
+    auto* bytes = static_cast<const char*>(data);
+    auto flags = static_cast<juce::uint8>(bytes[sizeof(BinaryLogEncoder::Magic)]);
+    auto showTimestamps = (flags & BinaryLogEncoder::ShowTimestampsFlag) != 0;
+    
+    ChunkReader reader { bytes + headerSize, bytes + numBytes };
+    std::unordered_map<juce::uint64, juce::String> threadNames;
+    std::unordered_map<juce::uint64, std::string> templates;
+    std::unordered_map<juce::uint64, juce::String> categories;
+    juce::int64 timestamp = 0;
+    
+    //set by a Level chunk, for the record that comes after it
+    juce::String levelAndCategory;
+    
+    auto truncated = []() { return juce::Result::fail("The log ends part way through a chunk"); };
+    
+    while( reader.position != reader.end )
+    {
+        auto type = static_cast<BinaryLogChunk>(*reader.position++);
+        const char* text = nullptr;
+        size_t length = 0;
+        
+        switch( type )
+        {
+            case BinaryLogChunk::Banner:
+            {
+                juce::uint64 startTimeMillis = 0;
+                if( reader.readVarint(startTimeMillis) == false || reader.readBytes(text, length) == false )
+                    return truncated();
+                
+                if( length > 0 )
+                    out << juce::String::fromUTF8(text, static_cast<int>(length)) << juce::newLine;
+                
+                if( showTimestamps )
+                    out << LogClock::describeTimestamps(static_cast<juce::int64>(startTimeMillis)) << juce::newLine;
+                
+                break;
+            }
+            case BinaryLogChunk::ThreadName:
+            case BinaryLogChunk::Template:
+            case BinaryLogChunk::Category:
+            {
+                juce::uint64 id = 0;
+                if( reader.readVarint(id) == false || reader.readBytes(text, length) == false )
+                    return truncated();
+                
+                if( type == BinaryLogChunk::ThreadName )
+                    threadNames[id] = juce::String::fromUTF8(text, static_cast<int>(length));
+                else if( type == BinaryLogChunk::Template )
+                    templates[id] = std::string(text, length);
+                else
+                    categories[id] = juce::String::fromUTF8(text, static_cast<int>(length));
+                
+                break;
+            }
+            case BinaryLogChunk::Level:
+            {
+                juce::uint64 level = 0, categoryID = 0;
+                if( reader.readVarint(level) == false || reader.readVarint(categoryID) == false )
+                    return truncated();
+                
+                auto category = categories.find(categoryID);
+                if( category == categories.end() )
+                    return juce::Result::fail("A record refers to a category that was never written");
+                
+                levelAndCategory = getLogLevelName(static_cast<LogLevel>(level));
+                levelAndCategory << " [" << category->second << "] ";
+                break;
+            }
+            case BinaryLogChunk::Text:
+            case BinaryLogChunk::Deferred:
+            {
+                juce::uint64 delta = 0, producerID = 0, templateID = 0;
+                if( reader.readVarint(delta) == false || reader.readVarint(producerID) == false )
+                    return truncated();
+                
+                if( type == BinaryLogChunk::Deferred && reader.readVarint(templateID) == false )
+                    return truncated();
+                
+                if( reader.readBytes(text, length) == false )
+                    return truncated();
+                
+                auto name = threadNames.find(producerID);
+                if( name == threadNames.end() )
+                    return juce::Result::fail("A record refers to a thread name that was never written");
+                
+                timestamp += zigzagDecode(delta);
+                if( showTimestamps )
+                {
+                    LogClock::writeMilliseconds(out, timestamp * 1000);
+                    out << ": ";
+                }
+                
+                out << "[" << name->second << "]: " << levelAndCategory;
+                levelAndCategory.clear();
+                
+                if( type == BinaryLogChunk::Deferred )
+                {
+                    auto formatString = templates.find(templateID);
+                    if( formatString == templates.end() )
+                        return juce::Result::fail("A record refers to a template that was never written");
+                    
+                    out << LogArguments::format(formatString->second.c_str(), text, length);
+                }
+                else
+                {
+                    out << juce::String::fromUTF8(text, static_cast<int>(length));
+                }
+                
+                out << juce::newLine;
+                break;
+            }
+            default:
+                return juce::Result::fail("Unknown chunk type: " + juce::String(static_cast<int>(type)));
+        }
+    }
+    
+    return juce::Result::ok();
+}
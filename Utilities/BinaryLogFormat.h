@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    BinaryLogFormat.h
+    Created: 16 Oct 2026 9:37:12pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LogRecord.h"
+#include "LogClock.h"
+
+/**
+ A compact binary alternative to the text log file, which skips formatting the messages when they are written.
+ 
+ The file starts with the 8 bytes "BMLBIN1\0", followed by a flags byte. Then come the chunks, each of which starts with a `BinaryLogChunk` byte:
+ - `Banner`: the wall-clock time that the timestamps count from, in milliseconds since 1970, then length, text. Decoded as it is, like the welcome message at the top of a text log file, followed by that time. Every file starts with one, even if its text is empty.
+ - `ThreadName`: producer ID, length, name.
+ - `Template`: template ID, length, format string.
+ - `Text`: timestamp delta, producer ID, length, message.
+ - `Deferred`: timestamp delta, producer ID, template ID, length, the record's encoded `LogArguments`.
+ - `Category`: category ID, length, name.
+ - `Level`: level, category ID. Comes just before the `Text` or `Deferred` record it belongs to, for records logged to a `LogCategory`.
+ 
+ Every number is a varint. Timestamp deltas are in microseconds, relative to the previous record, and zigzag encoded because they can be negative.
+ A thread name, template or category is written once, just before the first record that uses it, so a file can be decoded up to the last complete chunk while it is still being written.
+ */
+enum class BinaryLogChunk : juce::uint8
+{
+    Banner = 1,
+    ThreadName,
+    Template,
+    Text,
+    Deferred,
+    Category,
+    Level
+};
+
+/**
+ Encodes `LogRecord`s into the binary log format.
+ Each record's thread name and format string are looked up by their address, so they must stay put for as long as the encoder is in use, which they do for `LogRecord`s.
+ */
+struct BinaryLogEncoder
+{
+    static constexpr char Magic[8] = { 'B', 'M', 'L', 'B', 'I', 'N', '1', '\0' };
+    static constexpr juce::uint8 ShowTimestampsFlag = 1 << 0;
+    
+    static void writeHeader(juce::OutputStream& out, bool showTimestamps);
+    static void writeBanner(juce::OutputStream& out, juce::int64 startTimeMillis, const juce::String& text);
+    
+    /**
+     consumer side. Writes the record, preceded by its thread name, template and category if they haven't been written before.
+     */
+    void writeRecord(juce::OutputStream& out, juce::int64 timeOfCreationNs, const LogRecord& record);
+    /**
+     consumer side. Call this before a thread name that has been written is destroyed, so that a new name allocated at the same address gets a ThreadName chunk of its own.
+     */
+    void forgetThreadName(const juce::String& threadName);
+private:
+    std::unordered_map<const juce::String*, juce::uint32> producerIDs;
+    juce::uint32 nextProducerID = 0;
+    std::unordered_map<const char*, juce::uint32> templateIDs;
+    std::unordered_set<juce::uint16> writtenCategories;
+    juce::int64 previousTimestampMicroseconds = 0;
+    
+    juce::uint32 getProducerID(juce::OutputStream& out, const juce::String& threadName);
+    juce::uint32 getTemplateID(juce::OutputStream& out, const char* formatString);
+    void writeCategoryIfNeeded(juce::OutputStream& out, juce::uint16 categoryID);
+};
+
+/**
+ Converts a binary log back into the text that the text log file would have held.
+ Timestamps come back rounded to the microsecond.
+ */
+struct BinaryLogDecoder
+{
+    /**
+     Decodes everything up to the last complete chunk.
+     Fails if the data isn't a binary log, or ends part way through a chunk, which happens if the process writing it crashed.
+     */
+    static juce::Result decode(const void* data, size_t numBytes, juce::OutputStream& out);
+};
@@ -369,6 +369,35 @@ concept IsSorterType = requires(T t,
     { t.compare(a, b) } -> std::same_as<bool>;
 };
 
+/**
+ a type `T` is considered IsMonotonicSorterType for objects of type `ItemType` if it IsSorterType, and it declares `static constexpr bool isMonotonicPerProducer = true`.
+ This promises that the items from any single producer are already in sorted order.
+ */
+template<typename T, typename ItemType>
+concept IsMonotonicSorterType = IsSorterType<T, ItemType> && requires
+{
+    requires T::isMonotonicPerProducer;
+};
+
+/**
+ a type `T` is considered IsDeferredLogArgument if the logger can copy it into a `LogRecord` and format it later, on the logger's consumer side.
+ That's arithmetic types, enums, and pointers. `const char*` and `juce::String` arguments have their characters copied.
+ */
+template<typename T>
+concept IsDeferredLogArgument = std::is_arithmetic_v<T> ||
+                                std::is_enum_v<T> ||
+                                std::is_pointer_v<T> ||
+                                std::same_as<T, juce::String>;
+
+/**
+ a type `T` is considered IsLogField if it names a deferred log argument with a key, like the `LogField`s made by `logField()`.
+ */
+template<typename T>
+concept IsLogField = requires(const T& field)
+{
+    { field.key } -> std::convertible_to<const char*>;
+} && IsDeferredLogArgument<std::decay_t<decltype(T::value)>>;
+
 template<typename T>
 concept ConvertibleToMemoryBlock = requires(T t)
 {
@@ -0,0 +1,260 @@
+/*
+  ==============================================================================
+
+    EmergencyLogDrain.cpp
+    Created: 17 Oct 2026 3:48:15am
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#include "EmergencyLogDrain.h"
+
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+ #include <csignal>
+ #include <fcntl.h>
+ #include <unistd.h>
+
+namespace
+{
+    constexpr int CrashSignals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+    constexpr size_t MaxNumSignals = std::size(CrashSignals) + 1;
+    
+    //the drain copies each message into a slot on the stack, so it needs more than the bare minimum
+    constexpr size_t MinimumAlternateStackSize = 64 * 1024;
+    
+    /*
+     a thread's alternate signal stack. It's only allocated, never touched, until a signal is handled on it,
+     and it's switched off before it's freed, when the thread exits.
+     */
+    struct AlternateSignalStack
+    {
+        ~AlternateSignalStack()
+        {
+            if( memory != nullptr )
+            {
+                stack_t disabled {};
+                disabled.ss_flags = SS_DISABLE;
+                ::sigaltstack(&disabled, nullptr);
+            }
+        }
+        
+        bool install()
+        {
+            stack_t current {};
+            if( memory != nullptr || (::sigaltstack(nullptr, &current) == 0 && (current.ss_flags & SS_DISABLE) == 0) )
+            {
+                return true;
+            }
+            
+            auto size = std::max<size_t>(SIGSTKSZ, MinimumAlternateStackSize);
+            auto block = std::make_unique_for_overwrite<char[]>(size);
+            
+            stack_t stack {};
+            stack.ss_sp = block.get();
+            stack.ss_size = size;
+            if( ::sigaltstack(&stack, nullptr) != 0 )
+            {
+                return false;
+            }
+            
+            memory = std::move(block);
+            return true;
+        }
+        
+        std::unique_ptr<char[]> memory;
+    };
+    
+    thread_local AlternateSignalStack alternateSignalStack;
+    
+    //only written while the handlers aren't installed, so the handlers can read them without any synchronisation
+    struct InstalledState
+    {
+        int fileDescriptor = -1;
+        EmergencyLogDrain::DrainFunction drain = nullptr;
+        
+        int signals[MaxNumSignals] {};
+        struct sigaction previousActions[MaxNumSignals] {};
+        size_t numSignals = 0;
+        
+        bool replacedTerminateHandler = false;
+        std::terminate_handler previousTerminateHandler = nullptr;
+    };
+    
+    InstalledState state;
+    std::atomic<bool> isAnyInstalled { false };
+    std::atomic<bool> hasDrained { false };
+    
+    void drainOnce()
+    {
+        if( hasDrained.exchange(true) == false && state.drain != nullptr )
+        {
+            state.drain(state.fileDescriptor);
+        }
+    }
+    
+    void handleFatalSignal(int signalNumber)
+    {
+        //the previous handler may be one that returns, to a thread that was using errno
+        auto savedErrno = errno;
+        drainOnce();
+        
+        //put back whatever handled the signal before, and raise it again. It's delivered to that handler, or the default action, as soon as this one returns.
+        for( size_t i = 0; i < state.numSignals; ++i )
+        {
+            if( state.signals[i] == signalNumber )
+            {
+                ::sigaction(signalNumber, &state.previousActions[i], nullptr);
+            }
+        }
+        
+        ::raise(signalNumber);
+        errno = savedErrno;
+    }
+    
+    [[noreturn]] void handleTerminate()
+    {
+        drainOnce();
+        
+        if( state.previousTerminateHandler != nullptr )
+        {
+            state.previousTerminateHandler();
+        }
+        
+        std::abort();
+    }
+    
+    void installSignalHandler(int signalNumber)
+    {
+        struct sigaction action {};
+        action.sa_handler = handleFatalSignal;
+        sigemptyset(&action.sa_mask);
+        
+        //SA_ONSTACK, so a stack overflow can be handled. SA_RESETHAND, so a fault in the drain ends the process instead of recursing.
+        action.sa_flags = SA_ONSTACK | SA_RESETHAND;
+        
+        auto index = state.numSignals;
+        if( ::sigaction(signalNumber, &action, &state.previousActions[index]) == 0 )
+        {
+            state.signals[index] = signalNumber;
+            ++state.numSignals;
+        }
+    }
+}
+#endif
+
+EmergencyLogDrain::EmergencyLogDrain(const juce::File& file, EmergencyDrainOptions options, DrainFunction drainFunction) :
+dumpFile(file)
+{
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+    jassert(drainFunction != nullptr);
+    
+    if( isAnyInstalled.exchange(true) )
+    {
+        jassertfalse; //only one EmergencyLogDrain can be installed at a time!
+        return;
+    }
+    
+    state = {};
+    state.fileDescriptor = ::open(dumpFile.getFullPathName().toRawUTF8(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    state.drain = drainFunction;
+    hasDrained.store(false);
+    
+    if( state.fileDescriptor < 0 )
+    {
+        jassertfalse; //couldn't create the dump file
+        isAnyInstalled.store(false);
+        return;
+    }
+    
+    if( options.onCrashSignals )
+    {
+        installAlternateStackForCurrentThread();
+        
+        for( auto signalNumber : CrashSignals )
+        {
+            installSignalHandler(signalNumber);
+        }
+    }
+    
+    if( options.onSIGTERM )
+    {
+        installSignalHandler(SIGTERM);
+    }
+    
+    if( options.onTerminate )
+    {
+        state.previousTerminateHandler = std::set_terminate(handleTerminate);
+        state.replacedTerminateHandler = true;
+    }
+    
+    installed = true;
+#else
+    juce::ignoreUnused(options, drainFunction);
+#endif
+}
+
+EmergencyLogDrain::~EmergencyLogDrain()
+{
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+    if( installed == false )
+    {
+        return;
+    }
+    
+    for( size_t i = 0; i < state.numSignals; ++i )
+    {
+        ::sigaction(state.signals[i], &state.previousActions[i], nullptr);
+    }
+    
+    if( state.replacedTerminateHandler )
+    {
+        std::set_terminate(state.previousTerminateHandler);
+    }
+    
+    ::close(state.fileDescriptor);
+    state = {};
+    isAnyInstalled.store(false);
+    
+    //the process got through without needing the dump
+    if( dumpFile.getSize() == 0 )
+    {
+        dumpFile.deleteFile();
+    }
+#endif
+}
+
+bool EmergencyLogDrain::installAlternateStackForCurrentThread()
+{
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+    return alternateSignalStack.install();
+#else
+    return false;
+#endif
+}
+
+bool EmergencyLogDrain::writeAll(int fileDescriptor, const void* data, size_t numBytes)
+{
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+    auto* bytes = static_cast<const char*>(data);
+    while( numBytes > 0 )
+    {
+        auto numWritten = ::write(fileDescriptor, bytes, numBytes);
+        if( numWritten < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            
+            return false;
+        }
+        
+        bytes += numWritten;
+        numBytes -= static_cast<size_t>(numWritten);
+    }
+    
+    return true;
+#else
+    juce::ignoreUnused(fileDescriptor, data, numBytes);
+    return false;
+#endif
+}
@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    EmergencyLogDrain.h
+    Created: 17 Oct 2026 3:48:15am
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ When the emergency drain runs.
+ - `onCrashSignals`: SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT.
+ - `onSIGTERM`: only for processes that don't handle SIGTERM themselves, as a graceful shutdown writes everything to the log anyway.
+ - `onTerminate`: `std::terminate()`, ex: from an uncaught exception.
+ */
+struct EmergencyDrainOptions
+{
+    bool onCrashSignals = true;
+    bool onSIGTERM = false;
+    bool onTerminate = true;
+};
+
+/**
+ Runs a drain function when the process is about to die, so the log messages that explain why can be saved.
+ 
+ The dump file is opened up front, and the drain function is handed its file descriptor, as opening a file isn't something to rely on while crashing.
+ The drain function runs in a signal handler, so it must be async-signal-safe: no locks, no allocation, and no syscalls other than `write()`. `writeAll()` helps with that.
+ It runs at most once, however many fatal signals follow it, and a fault inside the drain itself gets the default action instead of running it again.
+ Afterwards, the signal is handed on to whichever handler was installed before, or the default action, which ends the process as it would have without the drain.
+ 
+ A thread that overflows its stack has no room left on it to run a signal handler, so the handlers run on an alternate signal stack.
+ Each thread needs its own: the thread that installs the drain is given one, and other threads that could crash should call `installAlternateStackForCurrentThread()`.
+ 
+ Signal handlers belong to the whole process, so only one `EmergencyLogDrain` can be installed at a time.
+ Destroying it puts back the handlers it replaced, and deletes the dump file if nothing was written to it.
+ 
+ Only POSIX systems are supported. Elsewhere, it does nothing.
+ */
+struct EmergencyLogDrain
+{
+    using DrainFunction = void (*)(int fileDescriptor);
+    
+    EmergencyLogDrain(const juce::File& dumpFile, EmergencyDrainOptions options, DrainFunction drainFunction);
+    ~EmergencyLogDrain();
+    
+    bool isInstalled() const { return installed; }
+    const juce::File& getFile() const { return dumpFile; }
+    
+    /**
+     async-signal-safe. Writes all of `numBytes`, carrying on after partial writes and interruptions.
+     */
+    static bool writeAll(int fileDescriptor, const void* data, size_t numBytes);
+    
+    /**
+     Gives the calling thread an alternate signal stack, which it keeps until it exits, so the drain can run even if the thread overflows its own stack.
+     Does nothing if the thread already has one, ex: from a sanitizer. Returns false if it couldn't be set up.
+     */
+    static bool installAlternateStackForCurrentThread();
+private:
+    juce::File dumpFile;
+    bool installed = false;
+    
+    JUCE_DECLARE_NON_COPYABLE(EmergencyLogDrain)
+};
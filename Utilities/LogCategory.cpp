@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    LogCategory.cpp
+    Created: 16 Oct 2026 11:48:05pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#include "LogCategory.h"
+
+namespace
+{
+    /*
+     IDs are never reused, so a record's ID always leads back to the name it was logged with.
+     ID 0 is left out, as it's what records logged without a category carry.
+     */
+    struct CategoryRegistry
+    {
+        juce::CriticalSection lock;
+        std::array<LogCategory*, LogCategory::MaxNumCategories> categories {};
+        std::array<std::atomic<const char*>, LogCategory::MaxNumCategories> names {};
+        int nextID = 1;
+    };
+    
+    //categories are usually statics, so the registry has to exist before the first of them is constructed
+    CategoryRegistry& getRegistry()
+    {
+        static CategoryRegistry registry;
+        return registry;
+    }
+}
+
+LogCategory::LogCategory(const char* n, LogLevel initialLevel) :
+name(n),
+minimumLevel(initialLevel)
+{
+    auto& registry = getRegistry();
+    const juce::ScopedLock lock(registry.lock);
+    
+    if( registry.nextID == MaxNumCategories )
+    {
+        jassertfalse; //too many categories. This one's messages are logged without their level or category.
+        return;
+    }
+    
+    id = static_cast<juce::uint16>(registry.nextID++);
+    registry.categories[id] = this;
+    registry.names[id].store(name, std::memory_order_release);
+}
+
+LogCategory::~LogCategory()
+{
+    auto& registry = getRegistry();
+    const juce::ScopedLock lock(registry.lock);
+    registry.categories[id] = nullptr;
+}
+
+bool LogCategory::setLevel(juce::StringRef categoryName, LogLevel newLevel)
+{
+    auto& registry = getRegistry();
+    const juce::ScopedLock lock(registry.lock);
+    
+    auto found = false;
+    for( auto* category : registry.categories )
+    {
+        if( category != nullptr && categoryName == category->getName() )
+        {
+            category->setLevel(newLevel);
+            found = true;
+        }
+    }
+    
+    return found;
+}
+
+const char* LogCategory::getName(juce::uint16 categoryID)
+{
+    if( categoryID >= MaxNumCategories )
+    {
+        return nullptr;
+    }
+    
+    return getRegistry().names[categoryID].load(std::memory_order_acquire);
+}
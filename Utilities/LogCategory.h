@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    LogCategory.h
+    Created: 16 Oct 2026 11:48:05pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+enum class LogLevel : juce::uint8
+{
+    Trace,
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+inline const char* getLogLevelName(LogLevel level)
+{
+    switch( level )
+    {
+        case LogLevel::Trace:   return "TRACE";
+        case LogLevel::Debug:   return "DEBUG";
+        case LogLevel::Info:    return "INFO";
+        case LogLevel::Warning: return "WARNING";
+        case LogLevel::Error:   return "ERROR";
+        case LogLevel::Off:     break;
+    }
+    
+    return "";
+}
+
+/**
+ The lowest level that `BML_LOG` compiles in. Anything below it, arguments and all, is compiled out.
+ Set it in the Projucer's preprocessor definitions, as the number of the `LogLevel`: BML_MINIMUM_LOG_LEVEL=2 keeps Info and up, for example.
+ */
+#ifndef BML_MINIMUM_LOG_LEVEL
+ #define BML_MINIMUM_LOG_LEVEL 0
+#endif
+
+static constexpr LogLevel MinimumLogLevel = static_cast<LogLevel>(BML_MINIMUM_LOG_LEVEL);
+
+/**
+ A named group of log messages, with its own level that can be changed while the program is running.
+ 
+ Define one for each part of the program that logs, and keep it alive for as long as that part does. Statics are the usual choice:
+ @code
+ LogCategory audioLog { "Audio", LogLevel::Info };
+ 
+ BML_LOG(Debug, audioLog, "buffer %d took %.2f ms", bufferIndex, elapsedMs);
+ @endcode
+ Checking whether a level is enabled is a single relaxed atomic load, so a call site that is turned off costs about as much as a branch.
+ 
+ Each category gets an ID, which is what log records carry. The `name` isn't copied, so it must be a string literal.
+ */
+struct LogCategory
+{
+    static constexpr int MaxNumCategories = 1024;
+    
+    LogCategory(const char* name, LogLevel initialLevel = LogLevel::Info);
+    ~LogCategory();
+    
+    bool isEnabled(LogLevel level) const noexcept
+    {
+        return level >= minimumLevel.load(std::memory_order_relaxed);
+    }
+    
+    //any thread. Messages already logged stay logged.
+    void setLevel(LogLevel newLevel) noexcept { minimumLevel.store(newLevel, std::memory_order_relaxed); }
+    LogLevel getLevel() const noexcept { return minimumLevel.load(std::memory_order_relaxed); }
+    
+    const char* getName() const { return name; }
+    juce::uint16 getID() const { return id; }
+    
+    /**
+     Sets the level of every live category called `categoryName`, for changing levels from a settings file or the command line.
+     Returns false if there aren't any.
+     */
+    static bool setLevel(juce::StringRef categoryName, LogLevel newLevel);
+    
+    /**
+     The name of the category with this ID, which stays valid after the category is destroyed, so that records logged to it can still be written out.
+     Returns nullptr for IDs that were never given out.
+     */
+    static const char* getName(juce::uint16 categoryID);
+private:
+    const char* name;
+    std::atomic<LogLevel> minimumLevel;
+    juce::uint16 id = 0;
+    
+    JUCE_DECLARE_NON_COPYABLE(LogCategory)
+};
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    LogClock.cpp
+    Created: 17 Oct 2026 1:37:52am
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#include "LogClock.h"
+
+//the two readings are taken back to back, so the start tick and the wall-clock time describe the same moment
+LogClock::LogClock() : LogClock(now(), juce::Time::getHighResolutionTicksPerSecond(), juce::Time::currentTimeMillis())
+{
+}
+
+LogClock::LogClock(Ticks start, Ticks perSecond, juce::int64 startMillis) :
+startTicks(start),
+ticksPerSecond(perSecond),
+startTimeMillis(startMillis)
+{
+    jassert(ticksPerSecond > 0);
+}
+
+juce::int64 LogClock::toNanoseconds(Ticks ticks) const
+{
+    constexpr juce::int64 NanosecondsPerSecond = 1'000'000'000;
+    
+    //split into whole seconds and the remainder, as multiplying all of the ticks by a billion would overflow after a few seconds
+    auto elapsed = ticks - startTicks;
+    auto seconds = elapsed / ticksPerSecond;
+    auto remainder = elapsed % ticksPerSecond;
+    return seconds * NanosecondsPerSecond + remainder * NanosecondsPerSecond / ticksPerSecond;
+}
+
+size_t LogClock::formatMilliseconds(juce::int64 nanoseconds, char* destination, int minimumWholeDigits)
+{
+    constexpr int NumDecimals = 6;
+    
+    //ticks taken before the clock was created are shown as 0
+    auto value = static_cast<juce::uint64>(std::max<juce::int64>(nanoseconds, 0));
+    auto fraction = value % 1'000'000;
+    auto whole = value / 1'000'000;
+    
+    //written backwards, from the last decimal
+    char digits[MaxTimestampLength];
+    auto* end = digits + MaxTimestampLength;
+    auto* position = end;
+    
+    for( int i = 0; i < NumDecimals; ++i )
+    {
+        *--position = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    
+    *--position = '.';
+    
+    for( int i = 0; i < minimumWholeDigits || whole > 0; ++i )
+    {
+        *--position = static_cast<char>('0' + whole % 10);
+        whole /= 10;
+    }
+    
+    auto length = static_cast<size_t>(end - position);
+    std::memcpy(destination, position, length);
+    return length;
+}
+
+void LogClock::writeMilliseconds(juce::OutputStream& out, juce::int64 nanoseconds)
+{
+    char timestamp[MaxTimestampLength];
+    out.write(timestamp, formatMilliseconds(nanoseconds, timestamp));
+}
+
+juce::String LogClock::describeTimestamps(juce::int64 startTimeMillis)
+{
+    return "Timestamps are milliseconds since " + juce::Time(startTimeMillis).toISO8601(true);
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    LogClock.h
+    Created: 17 Oct 2026 1:37:52am
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ Timestamps for log messages, cheap enough to take for every message.
+ 
+ `now()` returns the raw tick count of the high resolution clock as an integer: CLOCK_MONOTONIC on Linux, mach_absolute_time() on macOS, and QueryPerformanceCounter() on Windows.
+ Nothing is converted when the timestamp is taken. The consumer converts ticks to nanoseconds since the clock was created, and formats them with integer arithmetic, so no locale is involved.
+ 
+ Timestamps are relative to when the clock was created, not to when the machine booted, as `getMillisecondCounterHiRes()`'s were.
+ The clock is calibrated to the wall clock once, as it's created: `getStartTimeMillis()` is the wall-clock time of its first tick.
+ Every log file, binary log and crash ring records that time, so their timestamps can be lined up with the wall clock and with other processes' logs.
+ Changes to the wall clock after that, ex: from NTP, don't move the timestamps.
+ */
+struct LogClock
+{
+    using Ticks = juce::int64;
+    
+    static Ticks now() noexcept { return juce::Time::getHighResolutionTicks(); }
+    
+    //starts counting from now
+    LogClock();
+    
+    //for converting ticks that were taken by a LogClock in another process
+    LogClock(Ticks startTicks, Ticks ticksPerSecond, juce::int64 startTimeMillis);
+    
+    Ticks getStartTicks() const { return startTicks; }
+    Ticks getTicksPerSecond() const { return ticksPerSecond; }
+    
+    //the wall-clock time of getStartTicks(), in milliseconds since 1970
+    juce::int64 getStartTimeMillis() const { return startTimeMillis; }
+    
+    juce::int64 toNanoseconds(Ticks ticks) const;
+    
+    static constexpr size_t MaxTimestampLength = 32;
+    
+    /**
+     Writes `nanoseconds` as milliseconds with 6 decimal places, the same as "%f" of the milliseconds did,
+     but with the whole milliseconds padded to 8 digits, so timestamps line up until the clock has been running for over a day.
+     ex: "00001234.567890"
+     `destination` needs room for `MaxTimestampLength` characters. Returns the number written, without a terminating '\0'.
+     Pass a `minimumWholeDigits` of 1 for a plain number, ex: for JSON, which doesn't allow leading zeros.
+     */
+    static size_t formatMilliseconds(juce::int64 nanoseconds, char* destination, int minimumWholeDigits = 8);
+    static void writeMilliseconds(juce::OutputStream& out, juce::int64 nanoseconds);
+    
+    /**
+     The line written at the top of a log, so readers know what its timestamps count from.
+     ex: "Timestamps are milliseconds since 2026-10-16T04:19:08.123+00:00"
+     */
+    static juce::String describeTimestamps(juce::int64 startTimeMillis);
+private:
+    Ticks startTicks;
+    Ticks ticksPerSecond;
+    juce::int64 startTimeMillis;
+};
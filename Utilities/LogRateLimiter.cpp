@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    LogRateLimiter.cpp
+    Created: 17 Oct 2026 4:52:06am
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#include "LogRateLimiter.h"
+
+namespace
+{
+    //guards the list of call sites, and each call site's list of threads.
+    //it's only taken by a thread's first call to a call site, when the thread exits, and by the logger's reports.
+    juce::CriticalSection& getCallSitesLock()
+    {
+        static juce::CriticalSection lock;
+        return lock;
+    }
+    
+    LogCallSite*& getFirstCallSite()
+    {
+        static LogCallSite* first = nullptr;
+        return first;
+    }
+    
+    LogClock::Ticks getInterval(double messagesPerSecond)
+    {
+        jassert(messagesPerSecond > 0.0);
+        auto ticksPerSecond = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+        return std::max<LogClock::Ticks>(1, static_cast<LogClock::Ticks>(ticksPerSecond / messagesPerSecond));
+    }
+}
+
+//==============================================================================
+LogLimiterThreadState::~LogLimiterThreadState()
+{
+    const juce::ScopedLock lock(getCallSitesLock());
+    if( callSite == nullptr )
+    {
+        return;
+    }
+    
+    //the call site keeps this thread's count, so the messages it suppressed are still reported
+    callSite->numSuppressedByExitedThreads += numSuppressed.load(std::memory_order_relaxed);
+    
+    for( auto** link = &callSite->threads; *link != nullptr; link = &(*link)->next )
+    {
+        if( *link == this )
+        {
+            *link = next;
+            break;
+        }
+    }
+}
+
+//==============================================================================
+LogCallSite::LogCallSite()
+{
+    const juce::ScopedLock lock(getCallSitesLock());
+    next = std::exchange(getFirstCallSite(), this);
+}
+
+LogCallSite::~LogCallSite()
+{
+    const juce::ScopedLock lock(getCallSitesLock());
+    for( auto** link = &getFirstCallSite(); *link != nullptr; link = &(*link)->next )
+    {
+        if( *link == this )
+        {
+            *link = next;
+            break;
+        }
+    }
+    
+    //the threads that are still running leave it alone from now on
+    for( auto* thread = threads; thread != nullptr; thread = thread->next )
+    {
+        thread->callSite = nullptr;
+    }
+}
+
+void LogCallSite::addThread(LogLimiterThreadState& thread)
+{
+    const juce::ScopedLock lock(getCallSitesLock());
+    thread.callSite = this;
+    thread.next = std::exchange(threads, &thread);
+}
+
+juce::uint64 LogCallSite::sumThreadCounts() const noexcept
+{
+    auto sum = numSuppressedByExitedThreads;
+    for( auto* thread = threads; thread != nullptr; thread = thread->next )
+    {
+        sum += thread->numSuppressed.load(std::memory_order_relaxed);
+    }
+    
+    return sum;
+}
+
+void LogCallSite::reportSuppressedMessages(const ReportFunction& report)
+{
+    const juce::ScopedLock lock(getCallSitesLock());
+    for( auto* callSite = getFirstCallSite(); callSite != nullptr; callSite = callSite->next )
+    {
+        //a call site that hasn't let a message through yet hasn't suppressed any either
+        auto* format = callSite->statementFormat.load(std::memory_order_acquire);
+        if( format == nullptr )
+        {
+            continue;
+        }
+        
+        auto numSuppressed = callSite->getNumSuppressed();
+        if( numSuppressed > callSite->numReported )
+        {
+            report(*callSite->statementCategory.load(std::memory_order_relaxed),
+                   callSite->statementLevel.load(std::memory_order_relaxed),
+                   format,
+                   numSuppressed - callSite->numReported);
+            
+            callSite->numReported = numSuppressed;
+        }
+    }
+}
+
+//==============================================================================
+LogRateLimiter::LogRateLimiter(double messagesPerSecond, int burst) :
+interval(getInterval(messagesPerSecond)),
+burstTolerance(interval * std::max(burst - 1, 0))
+{
+    jassert(burst >= 1);
+}
+
+juce::uint32 LogRateLimiter::getNumCallsToSkip(const LogLimiterThreadState& thisThread, LogClock::Ticks now, LogClock::Ticks wait) noexcept
+{
+    //a thread that hasn't read the clock before doesn't know how often it calls yet
+    if( thisThread.lastClockRead == 0 )
+    {
+        return 0;
+    }
+    
+    //the calls this thread makes in half of the wait, at the rate it has been calling since it last read the clock
+    auto elapsed = std::max<LogClock::Ticks>(now - thisThread.lastClockRead, 1);
+    auto numCalls = (wait / 2) * static_cast<LogClock::Ticks>(thisThread.numCallsSinceClockRead) / elapsed;
+    return static_cast<juce::uint32>(std::clamp<LogClock::Ticks>(numCalls, 0, MaxCallsToSkip));
+}
+
+LogSampler::LogSampler(juce::uint32 n) :
+oneInN(std::max<juce::uint32>(n, 1))
+{
+    jassert(n >= 1);
+}
+
+juce::uint64 LogSampler::getNumSuppressed() const noexcept
+{
+    //calls 0, oneInN, 2 * oneInN... were let through
+    auto calls = numCalls.load(std::memory_order_relaxed);
+    return calls - (calls + oneInN - 1) / oneInN;
+}
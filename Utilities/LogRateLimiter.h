@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    LogRateLimiter.h
+    Created: 17 Oct 2026 4:52:06am
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LogClock.h"
+#include "LogCategory.h"
+
+struct LogCallSite;
+
+/**
+ The part of a rate limited log statement that belongs to each thread.
+ Suppressed messages are counted here, rather than in the limiter, so that a suppressed message doesn't write to memory other threads share.
+ `BML_LOG_RATE_LIMITED` keeps one in a thread_local at the call site. It joins its call site's list on its first call, and leaves it when the thread exits.
+ */
+struct LogLimiterThreadState
+{
+    LogLimiterThreadState() = default;
+    ~LogLimiterThreadState();
+    
+    //only written by this thread, and read by the logger when it reports the call site's suppressed messages
+    std::atomic<juce::uint64> numSuppressed { 0 };
+    
+    //suppresses calls without reading the clock, see LogRateLimiter
+    juce::uint32 numCallsToSkip = 0;
+    juce::uint32 numCallsSinceClockRead = 0;
+    LogClock::Ticks lastClockRead = 0;
+    
+    void countSuppressed() noexcept
+    {
+        numSuppressed.store(numSuppressed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+private:
+    friend struct LogCallSite;
+    friend struct LogRateLimiter;
+    
+    //guarded by the call sites' lock
+    LogCallSite* callSite = nullptr;
+    LogLimiterThreadState* next = nullptr;
+    
+    JUCE_DECLARE_NON_COPYABLE(LogLimiterThreadState)
+};
+
+/**
+ A rate limited or sampled log statement, as the logger sees it.
+ 
+ Every call site is added to a list when it's created. Once a second, the logger asks each one how many of its messages it has suppressed since it last asked,
+ and logs the ones that have suppressed some, ex: "suppressed 48213 similar messages: buffer %d took %.2f ms".
+ So the count reaches the log even if the statement isn't run again.
+ The category, level and format string the report is logged with are remembered from the first message the call site lets through.
+ */
+struct LogCallSite
+{
+    LogCallSite();
+    virtual ~LogCallSite();
+    
+    /**
+     producer side. Called with each message that's let through, and only does anything for the first.
+     */
+    void rememberStatement(const LogCategory& category, LogLevel level, const char* format) noexcept
+    {
+        if( statementFormat.load(std::memory_order_acquire) == nullptr )
+        {
+            statementCategory.store(&category, std::memory_order_relaxed);
+            statementLevel.store(level, std::memory_order_relaxed);
+            statementFormat.store(format, std::memory_order_release);
+        }
+    }
+    
+    using ReportFunction = std::function<void(const LogCategory& category, LogLevel level, const char* format, juce::uint64 numSuppressed)>;
+    
+    /**
+     consumer side. Calls `report` for every call site that has suppressed messages since the last call.
+     */
+    static void reportSuppressedMessages(const ReportFunction& report);
+protected:
+    //the number of messages suppressed since the call site was created
+    virtual juce::uint64 getNumSuppressed() const noexcept = 0;
+    
+    //the threads' own counts, and what's left of the threads that have exited. Guarded by the call sites' lock.
+    juce::uint64 sumThreadCounts() const noexcept;
+    void addThread(LogLimiterThreadState& thread);
+private:
+    friend struct LogLimiterThreadState;
+    
+    std::atomic<const LogCategory*> statementCategory { nullptr };
+    std::atomic<LogLevel> statementLevel { LogLevel::Info };
+    std::atomic<const char*> statementFormat { nullptr };
+    
+    //guarded by the call sites' lock
+    LogCallSite* next = nullptr;
+    LogLimiterThreadState* threads = nullptr;
+    juce::uint64 numSuppressedByExitedThreads = 0;
+    juce::uint64 numReported = 0;
+    
+    JUCE_DECLARE_NON_COPYABLE(LogCallSite)
+};
+
+/**
+ A token bucket for a single log statement, so a loop that logs too often can't fill its thread's fifo.
+ It lets `messagesPerSecond` through on average, and up to `burst` at once.
+ 
+ It's a GCRA (generic cell rate algorithm) bucket: the whole state is the time the next message is due, so it's one atomic, and any number of threads can share it without a lock.
+ Only messages that are let through write to the bucket.
+ 
+ Most suppressed messages don't read the clock either. When a thread reads it and finds the bucket empty, it works out how many of its calls fit in half of the wait, from how often it has been calling,
+ and suppresses that many, up to `MaxCallsToSkip`, with just a decrement of its own counter. Halving the wait means it reads the clock again before the bucket refills, and only a handful of times while it waits.
+ A thread that suddenly calls much less often can have up to `MaxCallsToSkip` more of its messages suppressed than necessary.
+ Suppressed messages are counted per thread, and reported by the logger, see `LogCallSite`.
+ 
+ Use it through `BML_LOG_RATE_LIMITED`, which keeps one in a static at the call site.
+ */
+struct LogRateLimiter : LogCallSite
+{
+    LogRateLimiter(double messagesPerSecond, int burst = 1);
+    
+    static constexpr juce::uint32 MaxCallsToSkip = 64;
+    
+    /**
+     @return true if the message may be logged.
+     */
+    bool tryAcquire(LogLimiterThreadState& thisThread) noexcept
+    {
+        if( thisThread.callSite == nullptr )
+        {
+            addThread(thisThread);
+        }
+        
+        ++thisThread.numCallsSinceClockRead;
+        if( thisThread.numCallsToSkip > 0 )
+        {
+            --thisThread.numCallsToSkip;
+            thisThread.countSuppressed();
+            return false;
+        }
+        
+        auto now = LogClock::now();
+        auto due = nextDue.load(std::memory_order_relaxed);
+        
+        for( ;; )
+        {
+            if( now < due - burstTolerance )
+            {
+                thisThread.numCallsToSkip = getNumCallsToSkip(thisThread, now, due - burstTolerance - now);
+                thisThread.numCallsSinceClockRead = 0;
+                thisThread.lastClockRead = now;
+                thisThread.countSuppressed();
+                return false;
+            }
+            
+            //on failure, 'due' is reloaded with the time another thread just claimed, so check again against that
+            if( nextDue.compare_exchange_weak(due, std::max(due, now) + interval, std::memory_order_relaxed) )
+            {
+                break;
+            }
+        }
+        
+        thisThread.numCallsSinceClockRead = 0;
+        thisThread.lastClockRead = now;
+        return true;
+    }
+protected:
+    juce::uint64 getNumSuppressed() const noexcept override { return sumThreadCounts(); }
+private:
+    static juce::uint32 getNumCallsToSkip(const LogLimiterThreadState& thisThread, LogClock::Ticks now, LogClock::Ticks wait) noexcept;
+    
+    const LogClock::Ticks interval;
+    const LogClock::Ticks burstTolerance;
+    
+    std::atomic<LogClock::Ticks> nextDue { std::numeric_limits<LogClock::Ticks>::min() / 2 };
+    
+    JUCE_DECLARE_NON_COPYABLE(LogRateLimiter)
+};
+
+/**
+ Lets 1 in every `oneInN` messages from a single log statement through, starting with the first, whichever threads they come from.
+ The calls are counted by one relaxed atomic, on a cache line of its own, which every call increments. The number suppressed is worked out from it when the logger reports them.
+ 
+ Use it through `BML_LOG_SAMPLED`, which keeps one in a static at the call site.
+ */
+struct LogSampler : LogCallSite
+{
+    explicit LogSampler(juce::uint32 oneInN);
+    
+    /**
+     @return true if the message may be logged.
+     */
+    bool tryAcquire() noexcept
+    {
+        return numCalls.fetch_add(1, std::memory_order_relaxed) % oneInN == 0;
+    }
+protected:
+    juce::uint64 getNumSuppressed() const noexcept override;
+private:
+    const juce::uint64 oneInN;
+    
+    //aligned, so the counter doesn't share a cache line with anything that isn't this sampler
+    alignas(64) std::atomic<juce::uint64> numCalls { 0 };
+    
+    JUCE_DECLARE_NON_COPYABLE(LogSampler)
+};
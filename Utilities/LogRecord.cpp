@@ -0,0 +1,519 @@
+/*
+  ==============================================================================
+
+    LogRecord.cpp
+    Created: 16 Oct 2026 6:14:52pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#include "LogRecord.h"
+#include <charconv>
+
+static_assert(std::is_trivially_copyable_v<LogRecord>, "LogRecords are copied into fifo slots, and must never need a destructor");
+
+bool LogArena::write(const char* data, size_t numBytes, juce::uint64& position)
+{
+    auto* destination = allocate(numBytes, position);
+    if( destination == nullptr )
+        return false;
+    
+    std::memcpy(destination, data, numBytes);
+    return true;
+}
+
+char* LogArena::allocate(size_t numBytes, juce::uint64& position)
+{
+    if( numBytes > Capacity )
+        return nullptr;
+    
+    auto start = writePosition;
+    auto offset = start % Capacity;
+    if( offset + numBytes > Capacity )
+    {
+        //don't split the message across the end of the ring
+        start += Capacity - offset;
+    }
+    
+    if( start + numBytes - readPosition.load(std::memory_order_acquire) > Capacity )
+        return nullptr;
+    
+    writePosition = start + numBytes;
+    position = start;
+    return bytes.data() + start % Capacity;
+}
+
+const char* LogArena::getData(juce::uint64 position) const
+{
+    return bytes.data() + position % Capacity;
+}
+
+void LogArena::releaseUpTo(juce::uint64 position)
+{
+    readPosition.store(position, std::memory_order_release);
+}
+
+//==============================================================================
+namespace
+{
+    template<typename ValueType>
+    ValueType readValue(const char*& data)
+    {
+        ValueType value;
+        std::memcpy(&value, data, sizeof(value));
+        data += sizeof(value);
+        return value;
+    }
+    
+    bool isConversion(char c)
+    {
+        return std::strchr("diouxXeEfFgGaAcspn", c) != nullptr;
+    }
+    
+    bool isIntegerConversion(char c)
+    {
+        return std::strchr("diouxXc", c) != nullptr;
+    }
+    
+    /*
+     the number of bytes the argument at `data` takes up after its type byte, or 0 if its type isn't one we know.
+     Strings are only sized if their length fits before `end`.
+     */
+    size_t getValueSize(LogArguments::Type type, const char* data, const char* end)
+    {
+        switch( type )
+        {
+            case LogArguments::Type::Int64:
+            case LogArguments::Type::UInt64:
+            case LogArguments::Type::Pointer:
+            case LogArguments::Type::Double:
+                return sizeof(juce::uint64);
+            case LogArguments::Type::Bool:
+            case LogArguments::Type::Char:
+                return 1;
+            case LogArguments::Type::String:
+            case LogArguments::Type::Key:
+            {
+                if( end - data < static_cast<std::ptrdiff_t>(sizeof(juce::uint16)) )
+                    return 0;
+                
+                juce::uint16 length;
+                std::memcpy(&length, data, sizeof(length));
+                return sizeof(length) + length + 1;
+            }
+        }
+        
+        return 0;
+    }
+    
+    /*
+     formats one argument with the flags, width and precision of its conversion spec.
+     The length modifier in the format string is ignored, and replaced with the one that suits the argument's stored type.
+     The arguments may have been read back from a file, so nothing past `end` is read.
+     @return false if the argument's type is unknown, or it doesn't fit before `end`. Nothing is formatted then, and `data` is left where it was.
+     */
+    bool formatArgument(std::string& result, const std::string& flagsWidthPrecision, char conversion, const char*& data, const char* end)
+    {
+        auto type = static_cast<LogArguments::Type>(*data);
+        auto valueSize = getValueSize(type, data + 1, end);
+        if( valueSize == 0 || end - (data + 1) < static_cast<std::ptrdiff_t>(valueSize) )
+            return false;
+        
+        ++data;
+        
+        auto formatWithSpec = [&](const std::string& spec, auto ... values)
+        {
+            char buffer[128];
+            auto numChars = std::snprintf(buffer, sizeof(buffer), spec.c_str(), values...);
+            if( numChars < 0 )
+                return;
+            
+            if( static_cast<size_t>(numChars) < sizeof(buffer) )
+            {
+                result.append(buffer, static_cast<size_t>(numChars));
+                return;
+            }
+            
+            //too long for the buffer, so format it again, straight into the result
+            auto start = result.size();
+            result.resize(start + static_cast<size_t>(numChars) + 1);
+            std::snprintf(result.data() + start, static_cast<size_t>(numChars) + 1, spec.c_str(), values...);
+            result.resize(start + static_cast<size_t>(numChars));
+        };
+        
+        auto formatWith = [&](const char* lengthModifier, char convertAs, auto value)
+        {
+            formatWithSpec("%" + flagsWidthPrecision + lengthModifier + convertAs, value);
+        };
+        
+        switch( type )
+        {
+            case LogArguments::Type::Int64:
+            case LogArguments::Type::UInt64:
+            case LogArguments::Type::Pointer:
+            case LogArguments::Type::Bool:
+            case LogArguments::Type::Char:
+            {
+                juce::uint64 bits = 0;
+                if( type == LogArguments::Type::Bool || type == LogArguments::Type::Char )
+                    bits = static_cast<juce::uint64>(static_cast<unsigned char>(*data++));
+                else
+                    bits = readValue<juce::uint64>(data);
+                
+                auto isSigned = type == LogArguments::Type::Int64;
+                
+                if( type == LogArguments::Type::Pointer || conversion == 'p' )
+                    formatWith("", 'p', reinterpret_cast<void*>(static_cast<juce::pointer_sized_uint>(bits)));
+                else if( conversion == 'c' )
+                    formatWith("", 'c', static_cast<int>(bits));
+                else if( conversion == 's' && type == LogArguments::Type::Bool )
+                    formatWith("", 's', bits != 0 ? "true" : "false");
+                else if( conversion == 's' && isSigned )
+                    formatWith("ll", 'd', static_cast<long long>(bits));
+                else if( conversion == 's' )
+                    formatWith("ll", 'u', static_cast<unsigned long long>(bits));
+                else if( isIntegerConversion(conversion) == false )
+                    formatWith("", conversion, isSigned ? static_cast<double>(static_cast<juce::int64>(bits)) : static_cast<double>(bits));
+                else if( conversion == 'd' || conversion == 'i' )
+                    formatWith("ll", conversion, static_cast<long long>(bits));
+                else
+                    formatWith("ll", conversion, static_cast<unsigned long long>(bits));
+                
+                break;
+            }
+            case LogArguments::Type::Double:
+            {
+                auto value = readValue<double>(data);
+                if( isIntegerConversion(conversion) )
+                    formatWith("ll", 'd', static_cast<long long>(value));
+                else if( conversion == 's' || conversion == 'p' )
+                    formatWith("", 'g', value);
+                else
+                    formatWith("", conversion, value);
+                
+                break;
+            }
+            case LogArguments::Type::String:
+            case LogArguments::Type::Key:
+            {
+                //the stored length limits how much is read, rather than the null terminator, which a damaged file may not have
+                auto length = readValue<juce::uint16>(data);
+                auto precisionStart = flagsWidthPrecision.find('.');
+                
+                int precision = length;
+                if( precisionStart != std::string::npos )
+                    precision = std::min(precision, std::atoi(flagsWidthPrecision.c_str() + precisionStart + 1));
+                
+                formatWithSpec("%" + flagsWidthPrecision.substr(0, precisionStart) + ".*s", precision, data);
+                data += length + 1;
+                break;
+            }
+        }
+        
+        return true;
+    }
+    
+    template<typename ValueType>
+    void appendNumber(std::string& result, ValueType value)
+    {
+        //the shortest text that reads back as the same value, without allocating or depending on the locale
+        char buffer[32];
+        auto converted = std::to_chars(buffer, std::end(buffer), value);
+        result.append(buffer, converted.ptr);
+    }
+    
+    enum class FieldStyle
+    {
+        Text,
+        Json
+    };
+    
+    /*
+     appends the fields of a structured message. Everything is bounds checked, as the fields may have been read back from a file.
+     Strings are quoted in both styles, so that a value with spaces or an '=' in it can't be mistaken for more fields.
+     */
+    void appendFields(std::string& result, const char* data, size_t numBytes, FieldStyle style)
+    {
+        using Type = LogArguments::Type;
+        
+        auto* end = data + numBytes;
+        auto isWholeArgumentAt = [end](const char* position)
+        {
+            if( position >= end )
+                return false;
+            
+            auto valueSize = getValueSize(static_cast<Type>(*position), position + 1, end);
+            return valueSize > 0 && end - (position + 1) >= static_cast<std::ptrdiff_t>(valueSize);
+        };
+        
+        auto isFirst = true;
+        while( isWholeArgumentAt(data) && static_cast<Type>(*data) == Type::Key )
+        {
+            ++data;
+            auto keyLength = readValue<juce::uint16>(data);
+            std::string_view key(data, keyLength);
+            data += keyLength + 1;
+            
+            if( isWholeArgumentAt(data) == false )
+                return;
+            
+            auto type = static_cast<Type>(*data);
+            
+            if( style == FieldStyle::Text )
+            {
+                result += ' ';
+                result.append(key);
+                result += '=';
+            }
+            else
+            {
+                if( isFirst == false )
+                    result += ',';
+                
+                LogArguments::appendJsonString(result, key);
+                result += ':';
+            }
+            
+            isFirst = false;
+            ++data;
+            
+            switch( type )
+            {
+                case Type::Int64:
+                    appendNumber(result, readValue<juce::int64>(data));
+                    break;
+                case Type::UInt64:
+                    appendNumber(result, readValue<juce::uint64>(data));
+                    break;
+                case Type::Double:
+                {
+                    auto value = readValue<double>(data);
+                    if( style == FieldStyle::Json && std::isfinite(value) == false )
+                        result += "null";
+                    else
+                        appendNumber(result, value);
+                    break;
+                }
+                case Type::Bool:
+                    result += *data++ != 0 ? "true" : "false";
+                    break;
+                case Type::Char:
+                    LogArguments::appendJsonString(result, std::string_view(data++, 1));
+                    break;
+                case Type::Pointer:
+                {
+                    char buffer[2 + 16] = { '0', 'x' };
+                    auto converted = std::to_chars(buffer + 2, std::end(buffer), readValue<juce::uint64>(data), 16);
+                    std::string_view pointer(buffer, static_cast<size_t>(converted.ptr - buffer));
+                    
+                    if( style == FieldStyle::Json )
+                        LogArguments::appendJsonString(result, pointer);
+                    else
+                        result += pointer;
+                    break;
+                }
+                case Type::String:
+                case Type::Key:
+                {
+                    auto length = readValue<juce::uint16>(data);
+                    LogArguments::appendJsonString(result, std::string_view(data, length));
+                    data += length + 1;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+juce::String LogArguments::format(const char* formatString, const char* encodedArguments, size_t numBytes)
+{
+    std::string result;
+    format(result, formatString, encodedArguments, numBytes);
+    return juce::String::fromUTF8(result.data(), static_cast<int>(result.size()));
+}
+
+void LogArguments::format(std::string& result, const char* formatString, const char* encodedArguments, size_t numBytes)
+{
+    if( isStructured(encodedArguments, numBytes) )
+    {
+        result += formatString;
+        appendFields(result, encodedArguments, numBytes, FieldStyle::Text);
+        return;
+    }
+    
+    auto* data = encodedArguments;
+    auto* end = encodedArguments + numBytes;
+    
+    for( auto* c = formatString; *c != '\0'; ++c )
+    {
+        if( *c != '%' )
+        {
+            result += *c;
+            continue;
+        }
+        
+        if( c[1] == '%' )
+        {
+            result += '%';
+            ++c;
+            continue;
+        }
+        
+        //%[flags][width][.precision][length]conversion
+        auto* specStart = c + 1;
+        auto* spec = specStart;
+        while( *spec != '\0' && std::strchr("-+ #0", *spec) != nullptr ) ++spec;
+        while( *spec >= '0' && *spec <= '9' ) ++spec;
+        if( *spec == '.' )
+        {
+            ++spec;
+            while( *spec >= '0' && *spec <= '9' ) ++spec;
+        }
+        
+        std::string flagsWidthPrecision(specStart, spec);
+        while( *spec != '\0' && std::strchr("hlLqjzt", *spec) != nullptr ) ++spec;
+        
+        if( isConversion(*spec) == false || *spec == 'n' || data >= end )
+        {
+            //not something we can format, or we've run out of arguments, so leave it as it is
+            result.append(c, spec + (*spec != '\0' ? 1 : 0));
+            c = *spec != '\0' ? spec : spec - 1;
+            continue;
+        }
+        
+        if( formatArgument(result, flagsWidthPrecision, *spec, data, end) == false )
+        {
+            //the rest of the arguments can't be trusted, so leave this conversion and the ones after it as they are
+            result.append(c, spec + 1);
+            data = end;
+        }
+        
+        c = spec;
+    }
+}
+
+void LogArguments::appendJsonFields(std::string& json, const char* encodedArguments, size_t numBytes)
+{
+    appendFields(json, encodedArguments, numBytes, FieldStyle::Json);
+}
+
+void LogArguments::appendJsonString(std::string& json, std::string_view text)
+{
+    static constexpr char HexDigits[] = "0123456789abcdef";
+    
+    json += '"';
+    for( auto c : text )
+    {
+        switch( c )
+        {
+            case '"':  json += "\\\""; break;
+            case '\\': json += "\\\\"; break;
+            case '\n': json += "\\n"; break;
+            case '\r': json += "\\r"; break;
+            case '\t': json += "\\t"; break;
+            default:
+            {
+                //everything else below a space must be escaped too. UTF-8 passes through as it is.
+                if( static_cast<unsigned char>(c) < 0x20 )
+                {
+                    json += "\\u00";
+                    json += HexDigits[(c >> 4) & 0xF];
+                    json += HexDigits[c & 0xF];
+                }
+                else
+                {
+                    json += c;
+                }
+            }
+        }
+    }
+    
+    json += '"';
+}
+
+//==============================================================================
+LogRecord::LogRecord(const juce::String& name, LogArena& producerArena, juce::StringRef message) :
+threadName(&name)
+{
+    auto* data = message.text.getAddress();
+    auto size = message.text.sizeInBytes() - 1; //sizeInBytes() includes the null terminator
+    
+    if( auto* destination = reserve(producerArena, size) )
+    {
+        std::memcpy(destination, data, size);
+        return;
+    }
+    
+    copyTruncated(data, size);
+}
+
+char* LogRecord::reserve(LogArena& producerArena, size_t numBytesNeeded)
+{
+    if( numBytesNeeded <= InlineCapacity )
+    {
+        numBytes = static_cast<juce::uint32>(numBytesNeeded);
+        return inlineText;
+    }
+    
+    if( auto* destination = producerArena.allocate(numBytesNeeded, arenaPosition) )
+    {
+        arena = &producerArena;
+        numBytes = static_cast<juce::uint32>(numBytesNeeded);
+        return destination;
+    }
+    
+    return nullptr;
+}
+
+void LogRecord::copyTruncated(const char* data, size_t size)
+{
+    if( size <= InlineCapacity )
+    {
+        std::memcpy(inlineText, data, size);
+        numBytes = static_cast<juce::uint32>(size);
+        truncated = true;
+        return;
+    }
+    
+    //keep as much as fits, without cutting a UTF-8 character in half.
+    auto numToKeep = InlineCapacity - 3;
+    while( numToKeep > 0 && (static_cast<unsigned char>(data[numToKeep]) & 0xC0) == 0x80 )
+    {
+        --numToKeep;
+    }
+    
+    std::memcpy(inlineText, data, numToKeep);
+    std::memcpy(inlineText + numToKeep, "...", 3);
+    numBytes = static_cast<juce::uint32>(numToKeep + 3);
+    truncated = true;
+}
+
+const juce::String& LogRecord::getThreadName() const
+{
+    jassert(threadName != nullptr);
+    return *threadName;
+}
+
+const char* LogRecord::getData() const
+{
+    return arena != nullptr ? arena->getData(arenaPosition) : inlineText;
+}
+
+juce::String LogRecord::getMessage() const
+{
+    if( isDeferred() )
+    {
+        return LogArguments::format(formatString, getData(), numBytes);
+    }
+    
+    return juce::String::fromUTF8(getData(), static_cast<int>(numBytes));
+}
+
+void LogRecord::releaseArenaSpace() const
+{
+    if( arena != nullptr )
+    {
+        arena->releaseUpTo(arenaPosition + numBytes);
+    }
+}
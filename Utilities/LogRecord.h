@@ -0,0 +1,362 @@
+/*
+  ==============================================================================
+
+    LogRecord.h
+    Created: 16 Oct 2026 6:14:52pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Concepts.h"
+#include "LogCategory.h"
+
+/**
+ A byte ring that a single producer copies long log messages into, so that they don't need a heap allocation.
+ 
+ The producer `write()`s a message and gets back its position in the arena.
+ The consumer reads the message at that position, and then gives the space back with `releaseUpTo()`.
+ Messages are consumed in the order they were written, so giving back everything up to the end of the last message read is enough.
+ That also gives back the space of any message whose record was dropped before the consumer saw it.
+ 
+ A message is never split across the end of the ring. If it doesn't fit before the end, it starts at the beginning instead.
+ */
+struct LogArena
+{
+    static constexpr size_t Capacity = 64 * 1024;
+    
+    /**
+     producer side.
+     @return false if the arena doesn't have room for the message, because the consumer has fallen behind.
+     */
+    bool write(const char* data, size_t numBytes, juce::uint64& position);
+    
+    /**
+     producer side. Like `write()`, but hands back the space for the caller to fill in.
+     @return nullptr if the arena doesn't have room.
+     */
+    char* allocate(size_t numBytes, juce::uint64& position);
+    
+    const char* getData(juce::uint64 position) const;
+    
+    //consumer side
+    void releaseUpTo(juce::uint64 position);
+private:
+    std::array<char, Capacity> bytes;
+    
+    //only touched by the producer
+    juce::uint64 writePosition = 0;
+    
+    std::atomic<juce::uint64> readPosition { 0 };
+};
+
+/**
+ A named value for a structured log message. Make them with `logField()`, ex:
+ 
+ BML_LOG_FIELDS(Info, networkLog, "request finished", logField("status", 200), logField("path", url));
+ 
+ The key isn't copied until the message is logged, so it only needs to live that long.
+ */
+template<typename T>
+struct LogField
+{
+    const char* key;
+    T value;
+};
+
+template<typename T>
+requires IsDeferredLogArgument<T>
+LogField<T> logField(const char* key, T value)
+{
+    return { key, value };
+}
+
+/**
+ Packs the arguments of a deferred log message into bytes, and formats them later.
+ 
+ Each argument is stored as a one-byte `Type`, followed by its value.
+ Numbers are stored as 8 bytes. Strings are stored as a 2-byte length, followed by their characters and a null terminator.
+ 
+ `format()` understands printf-style format strings, like `juce::String::formatted()`.
+ Each conversion in the format string uses the next argument, converted to suit the conversion if its type doesn't match.
+ 
+ Structured messages are stored the same way, with each field's value preceded by its key, stored like a string but with the `Key` type.
+ Their format string is the message, which isn't formatted, and `format()` follows it with the fields as `key=value` pairs.
+ `appendJsonFields()` renders the same fields as the members of a JSON object instead.
+ */
+struct LogArguments
+{
+    enum class Type : juce::uint8
+    {
+        Int64,
+        UInt64,
+        Double,
+        Bool,
+        Char,
+        Pointer,
+        String,
+        Key
+    };
+    
+    //strings longer than this are cut short
+    static constexpr size_t MaxStringLength = 1024;
+    
+    template<typename ... Args>
+    requires (IsDeferredLogArgument<std::decay_t<Args>> && ...)
+    static size_t getEncodedSize(const Args& ... args)
+    {
+        return (getEncodedSizeOf(args) + ... + 0);
+    }
+    
+    template<typename ... Args>
+    requires (IsDeferredLogArgument<std::decay_t<Args>> && ...)
+    static void encode(char* destination, const Args& ... args)
+    {
+        (encodeOne(destination, args), ...);
+        juce::ignoreUnused(destination);
+    }
+    
+    template<typename ... Fields>
+    requires (IsLogField<Fields> && ...)
+    static size_t getEncodedFieldsSize(const Fields& ... fields)
+    {
+        return ((getEncodedStringSize(fields.key) + getEncodedSizeOf(fields.value)) + ... + 0);
+    }
+    
+    template<typename ... Fields>
+    requires (IsLogField<Fields> && ...)
+    static void encodeFields(char* destination, const Fields& ... fields)
+    {
+        ((encodeString(destination, fields.key, Type::Key), encodeOne(destination, fields.value)), ...);
+        juce::ignoreUnused(destination);
+    }
+    
+    static bool isStructured(const char* encodedArguments, size_t numBytes)
+    {
+        return numBytes > 0 && static_cast<Type>(*encodedArguments) == Type::Key;
+    }
+    
+    static juce::String format(const char* formatString, const char* encodedArguments, size_t numBytes);
+    
+    //the same as above, but appends the message to `result`, so a consumer can reuse its buffer
+    static void format(std::string& result, const char* formatString, const char* encodedArguments, size_t numBytes);
+    
+    /**
+     appends the encoded fields of a structured message as `"key":value` pairs, separated by commas, without the surrounding braces.
+     Numbers and bools are written as JSON numbers and bools, and everything else as strings. NaN and infinity are written as null.
+     */
+    static void appendJsonFields(std::string& json, const char* encodedArguments, size_t numBytes);
+    
+    //appends `text` as a quoted JSON string, escaping quotes, backslashes and control characters
+    static void appendJsonString(std::string& json, std::string_view text);
+private:
+    template<typename T>
+    static size_t getEncodedSizeOf(const T& arg)
+    {
+        using ArgType = std::decay_t<T>;
+        if constexpr( std::same_as<ArgType, juce::String> )
+            return getEncodedStringSize(arg.toRawUTF8());
+        else if constexpr( std::same_as<ArgType, const char*> || std::same_as<ArgType, char*> )
+            return getEncodedStringSize(arg);
+        else if constexpr( std::same_as<ArgType, bool> || std::same_as<ArgType, char> )
+            return 2;
+        else
+            return 1 + sizeof(juce::uint64);
+    }
+    
+    static size_t getEncodedStringSize(const char* text)
+    {
+        return 1 + sizeof(juce::uint16) + getStringLength(text) + 1;
+    }
+    
+    static size_t getStringLength(const char* text)
+    {
+        return text != nullptr ? juce::jmin(std::strlen(text), MaxStringLength) : 0;
+    }
+    
+    template<typename T>
+    static void encodeOne(char*& destination, const T& arg)
+    {
+        using ArgType = std::decay_t<T>;
+        if constexpr( std::same_as<ArgType, juce::String> )
+        {
+            encodeString(destination, arg.toRawUTF8());
+        }
+        else if constexpr( std::same_as<ArgType, const char*> || std::same_as<ArgType, char*> )
+        {
+            encodeString(destination, arg);
+        }
+        else if constexpr( std::same_as<ArgType, bool> )
+        {
+            *destination++ = static_cast<char>(Type::Bool);
+            *destination++ = arg ? 1 : 0;
+        }
+        else if constexpr( std::same_as<ArgType, char> )
+        {
+            *destination++ = static_cast<char>(Type::Char);
+            *destination++ = arg;
+        }
+        else if constexpr( std::is_pointer_v<ArgType> )
+        {
+            encodeValue(destination, Type::Pointer, static_cast<juce::uint64>(reinterpret_cast<juce::pointer_sized_uint>(arg)));
+        }
+        else if constexpr( std::is_floating_point_v<ArgType> )
+        {
+            encodeValue(destination, Type::Double, static_cast<double>(arg));
+        }
+        else if constexpr( std::is_enum_v<ArgType> )
+        {
+            encodeValue(destination, Type::Int64, static_cast<juce::int64>(arg));
+        }
+        else if constexpr( std::is_signed_v<ArgType> )
+        {
+            encodeValue(destination, Type::Int64, static_cast<juce::int64>(arg));
+        }
+        else
+        {
+            encodeValue(destination, Type::UInt64, static_cast<juce::uint64>(arg));
+        }
+    }
+    
+    template<typename ValueType>
+    static void encodeValue(char*& destination, Type type, ValueType value)
+    {
+        static_assert(sizeof(ValueType) == sizeof(juce::uint64));
+        *destination++ = static_cast<char>(type);
+        std::memcpy(destination, &value, sizeof(value));
+        destination += sizeof(value);
+    }
+    
+    static void encodeString(char*& destination, const char* text, Type type = Type::String)
+    {
+        auto length = static_cast<juce::uint16>(getStringLength(text));
+        *destination++ = static_cast<char>(type);
+        std::memcpy(destination, &length, sizeof(length));
+        destination += sizeof(length);
+        
+        if( length > 0 )
+            std::memcpy(destination, text, length);
+        
+        destination += length;
+        *destination++ = '\0';
+    }
+};
+
+/**
+ A fixed-size, trivially copyable log message, so that logging one is a copy into a fifo slot rather than a heap allocation.
+ 
+ Messages of up to `InlineCapacity` bytes are stored in the record itself.
+ Longer messages are copied into the producer's `LogArena`, and the record refers to them.
+ If the arena is full too, the message is truncated to fit in the record, and ends with "...".
+ 
+ A deferred record holds a format string and its encoded `LogArguments` instead of text, and is only formatted when `getMessage()` is called.
+ The format string isn't copied, so it must be a string literal, or live just as long.
+ A structured record is a deferred record whose arguments are `LogField`s, and whose format string is a plain message.
+ 
+ The record also refers to the name of the thread that logged it, which is only added to the message when the consumer writes it out.
+ Records logged to a `LogCategory` carry the category's ID and their `LogLevel` too. They fit in the record's padding, so they don't make it any bigger.
+ Both the thread name and the arena belong to the producer, and must outlive every record that refers to them.
+ */
+struct LogRecord
+{
+    static constexpr size_t InlineCapacity = 48;
+    
+    LogRecord() = default;
+    LogRecord(const juce::String& threadName, LogArena& arena, juce::StringRef message);
+    
+    template<typename ... Args>
+    requires (IsDeferredLogArgument<std::decay_t<Args>> && ...)
+    static LogRecord createDeferred(const juce::String& threadName, LogArena& arena, const char* format, const Args& ... args)
+    {
+        LogRecord record;
+        record.threadName = &threadName;
+        
+        auto numBytes = LogArguments::getEncodedSize(args...);
+        if( auto* payload = record.reserve(arena, numBytes) )
+        {
+            LogArguments::encode(payload, args...);
+            record.formatString = format;
+        }
+        else
+        {
+            //no room for the arguments, so log what we can of the format string instead
+            record.copyTruncated(format, std::strlen(format));
+        }
+        
+        return record;
+    }
+    
+    template<typename ... Fields>
+    requires (IsLogField<Fields> && ...)
+    static LogRecord createStructured(const juce::String& threadName, LogArena& arena, const char* message, const Fields& ... fields)
+    {
+        LogRecord record;
+        record.threadName = &threadName;
+        
+        auto numBytes = LogArguments::getEncodedFieldsSize(fields...);
+        if( auto* payload = record.reserve(arena, numBytes) )
+        {
+            LogArguments::encodeFields(payload, fields...);
+            record.formatString = message;
+        }
+        else
+        {
+            record.copyTruncated(message, std::strlen(message));
+        }
+        
+        return record;
+    }
+    
+    const juce::String& getThreadName() const;
+    
+    /**
+     consumer side. Copies the message out of the record, or the arena, formatting it first if it is deferred.
+     */
+    juce::String getMessage() const;
+    
+    /**
+     consumer side. Gives the record's space in the arena back to the producer. Call this once the message has been read.
+     */
+    void releaseArenaSpace() const;
+    
+    bool isTruncated() const { return truncated; }
+    bool isDeferred() const { return formatString != nullptr; }
+    bool isStructured() const { return isDeferred() && LogArguments::isStructured(getData(), numBytes); }
+    
+    /**
+     consumer side. The raw bytes behind `getMessage()`: the UTF-8 text, or for deferred records, the encoded `LogArguments` for `getFormatString()`.
+     */
+    const char* getData() const;
+    size_t getNumBytes() const { return numBytes; }
+    const char* getFormatString() const { return formatString; }
+    
+    //producer side
+    void setLevel(LogLevel newLevel, juce::uint16 newCategoryID) { level = newLevel; categoryID = newCategoryID; }
+    
+    //records logged without a category have no level either
+    bool hasLevel() const { return categoryID != 0; }
+    LogLevel getLevel() const { return level; }
+    juce::uint16 getCategoryID() const { return categoryID; }
+private:
+    const juce::String* threadName = nullptr;
+    
+    //only set for deferred records
+    const char* formatString = nullptr;
+    
+    //only set when the text, or the encoded arguments, are in the arena
+    LogArena* arena = nullptr;
+    juce::uint64 arenaPosition = 0;
+    
+    juce::uint32 numBytes = 0;
+    bool truncated = false;
+    LogLevel level = LogLevel::Info;
+    juce::uint16 categoryID = 0;
+    char inlineText[InlineCapacity];
+    
+    //the space for numBytes of text or arguments, either in the record, or in the arena. nullptr if neither has room.
+    char* reserve(LogArena& producerArena, size_t numBytesNeeded);
+    void copyTruncated(const char* data, size_t size);
+};
@@ -0,0 +1,231 @@
+/*
+  ==============================================================================
+
+    LogSinks.cpp
+    Created: 17 Oct 2026 2:26:40am
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#include "LogSinks.h"
+
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+ #include <sys/socket.h>
+ #include <sys/un.h>
+ #include <unistd.h>
+#endif
+
+FileSink::FileSink(const juce::File& file, WriteDurability durability, LogRotationOptions rotation) :
+writer(file, durability, rotation)
+{
+}
+
+void FileSink::writeBatch(const char* data, size_t numBytes)
+{
+    writer.rotateIfNeeded();
+    writer.writeBatch(data, numBytes);
+}
+
+//==============================================================================
+ConsoleSink::ConsoleSink(Stream s) :
+stream(s == Stream::StdOut ? std::cout : std::cerr)
+{
+}
+
+void ConsoleSink::writeBatch(const char* data, size_t numBytes)
+{
+    stream.write(data, static_cast<std::streamsize>(numBytes));
+    stream.flush();
+}
+
+//==============================================================================
+void DatagramSink::writeBatch(const char* data, size_t numBytes)
+{
+    while( numBytes > 0 )
+    {
+        auto length = std::min(numBytes, MaxDatagramSize);
+        
+        //end the datagram after the last whole message that fits, if there is one
+        if( length < numBytes )
+        {
+            auto lastNewLine = std::string_view(data, length).rfind('\n');
+            if( lastNewLine != std::string_view::npos )
+            {
+                length = lastNewLine + 1;
+            }
+        }
+        
+        sendDatagram(data, length);
+        data += length;
+        numBytes -= length;
+    }
+}
+
+UdpSink::UdpSink(const juce::String& hostName, int portNumber) :
+host(hostName),
+port(portNumber)
+{
+}
+
+void UdpSink::sendDatagram(const char* data, size_t numBytes)
+{
+    //a log collector that isn't running isn't an error worth stopping for, so failures are ignored
+    socket.write(host, port, data, static_cast<int>(numBytes));
+}
+
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+UnixSocketSink::UnixSocketSink(const juce::File& file) :
+socketFile(file)
+{
+    socketHandle = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    jassert(socketHandle >= 0);
+}
+
+UnixSocketSink::~UnixSocketSink()
+{
+    if( socketHandle >= 0 )
+    {
+        ::close(socketHandle);
+    }
+}
+
+void UnixSocketSink::sendDatagram(const char* data, size_t numBytes)
+{
+    if( socketHandle < 0 )
+    {
+        return;
+    }
+    
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    socketFile.getFullPathName().copyToUTF8(address.sun_path, sizeof(address.sun_path));
+    
+    ::sendto(socketHandle, data, numBytes, 0, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+#endif
+
+//==============================================================================
+MemoryRingSink::MemoryRingSink(size_t c) :
+ring(c),
+capacity(c)
+{
+    jassert(capacity > 0);
+}
+
+void MemoryRingSink::writeBatch(const char* data, size_t numBytes)
+{
+    const juce::ScopedLock sl(lock);
+    
+    //only the end of a batch bigger than the ring would survive anyway
+    if( numBytes >= capacity )
+    {
+        std::memcpy(ring.get(), data + (numBytes - capacity), capacity);
+        writePosition = 0;
+        hasWrapped = true;
+        return;
+    }
+    
+    auto numToEnd = std::min(numBytes, capacity - writePosition);
+    std::memcpy(ring.get() + writePosition, data, numToEnd);
+    std::memcpy(ring.get(), data + numToEnd, numBytes - numToEnd);
+    
+    writePosition += numBytes;
+    if( writePosition >= capacity )
+    {
+        writePosition -= capacity;
+        hasWrapped = true;
+    }
+}
+
+juce::String MemoryRingSink::getRecentText() const
+{
+    std::string text;
+    bool wrapped = false;
+    {
+        const juce::ScopedLock sl(lock);
+        wrapped = hasWrapped;
+        if( wrapped )
+        {
+            text.append(ring.get() + writePosition, capacity - writePosition);
+        }
+        
+        text.append(ring.get(), writePosition);
+    }
+    
+    //the oldest message has probably been partly overwritten
+    if( wrapped )
+    {
+        auto firstNewLine = text.find('\n');
+        text.erase(0, firstNewLine == std::string::npos ? text.size() : firstNewLine + 1);
+    }
+    
+    return juce::String::fromUTF8(text.data(), static_cast<int>(text.size()));
+}
+
+//==============================================================================
+AsyncLogSink::AsyncLogSink(std::unique_ptr<LogSink> s, OverflowOptions overflowOptions) :
+sink(std::move(s)),
+queue(overflowOptions)
+{
+    drained.reserve(QueueCapacity);
+    sinkThread = std::make_unique<ThreadRunner<AsyncLogSink>>(*this,
+                                                              "Log Sink",
+                                                              &AsyncLogSink::writeOnBackgroundThread,
+                                                              &AsyncLogSink::canRunSinkThread,
+                                                              ThreadLaunchType::Immediately,
+                                                              juce::Thread::Priority::low);
+}
+
+AsyncLogSink::~AsyncLogSink()
+{
+    //the sink thread is most likely asleep waiting for batches, so wake it up to see that it should exit.
+    sinkThread->signalThreadShouldExit();
+    batchesQueued.signal();
+    sinkThread.reset();
+    
+    writeQueuedBatches();
+}
+
+void AsyncLogSink::writeBatch(const char* data, size_t numBytes)
+{
+    if( numBytes == 0 )
+    {
+        return;
+    }
+    
+    queue.emplace([this](int, int) { batchesQueued.signal(); }, data, numBytes);
+}
+
+void AsyncLogSink::writeOnBackgroundThread(juce::Thread& thread)
+{
+    batchesQueued.wait(-1);
+    
+    if( thread.threadShouldExit() )
+    {
+        return;
+    }
+    
+    writeQueuedBatches();
+}
+
+void AsyncLogSink::writeQueuedBatches()
+{
+    while( queue.drainInto(drained, QueueCapacity) > 0 )
+    {
+        auto numDropped = queue.getNumDropped();
+        if( numDropped > numDroppedReported )
+        {
+            auto notice = "*** " + std::to_string(numDropped - numDroppedReported) + " batches of log messages were dropped, as this sink couldn't keep up ***\n";
+            sink->writeBatch(notice.data(), notice.size());
+            numDroppedReported = numDropped;
+        }
+        
+        for( const auto& batch : drained )
+        {
+            sink->writeBatch(batch.data(), batch.size());
+        }
+        
+        drained.clear();
+    }
+}
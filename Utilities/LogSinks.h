@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    LogSinks.h
+    Created: 17 Oct 2026 2:26:40am
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BatchedFileWriter.h"
+#include "OverflowingProducerQueue.h"
+#include "ThreadRunner.h"
+
+/**
+ Somewhere that log messages end up.
+ Messages arrive in batches: blocks of already formatted messages, each ending with a new line.
+ */
+struct LogSink
+{
+    virtual ~LogSink() = default;
+    virtual void writeBatch(const char* data, size_t numBytes) = 0;
+};
+
+/**
+ Appends batches to a file, rotating it if it gets too big or too old.
+ */
+struct FileSink : LogSink
+{
+    FileSink(const juce::File& file,
+             WriteDurability durability = WriteDurability::FlushPerBatch,
+             LogRotationOptions rotation = {});
+    
+    void writeBatch(const char* data, size_t numBytes) override;
+    const juce::File& getFile() const { return writer.getFile(); }
+private:
+    BatchedFileWriter writer;
+};
+
+/**
+ Writes batches to std::cout or std::cerr, flushing once per batch.
+ */
+struct ConsoleSink : LogSink
+{
+    enum class Stream
+    {
+        StdOut,
+        StdErr
+    };
+    
+    explicit ConsoleSink(Stream stream);
+    void writeBatch(const char* data, size_t numBytes) override;
+private:
+    std::ostream& stream;
+};
+
+/**
+ The base of the sinks that forward batches as datagrams, to a log collector.
+ Batches that are bigger than `MaxDatagramSize` are split between messages, so each datagram holds whole messages, unless a single message is too big by itself.
+ */
+struct DatagramSink : LogSink
+{
+    static constexpr size_t MaxDatagramSize = 8 * 1024;
+    
+    void writeBatch(const char* data, size_t numBytes) override;
+protected:
+    virtual void sendDatagram(const char* data, size_t numBytes) = 0;
+};
+
+/**
+ Sends batches to a UDP port, on this machine or another.
+ */
+struct UdpSink : DatagramSink
+{
+    UdpSink(const juce::String& hostName, int portNumber);
+protected:
+    void sendDatagram(const char* data, size_t numBytes) override;
+private:
+    juce::DatagramSocket socket;
+    juce::String host;
+    int port;
+};
+
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD
+/**
+ Sends batches to a Unix domain datagram socket, which a local log collector is listening on.
+ */
+struct UnixSocketSink : DatagramSink
+{
+    explicit UnixSocketSink(const juce::File& socketFile);
+    ~UnixSocketSink() override;
+protected:
+    void sendDatagram(const char* data, size_t numBytes) override;
+private:
+    juce::File socketFile;
+    int socketHandle = -1;
+    
+    JUCE_DECLARE_NON_COPYABLE(UnixSocketSink)
+};
+#endif
+
+/**
+ Keeps the most recent `capacity` bytes of log messages in memory, for showing the latest messages in the UI, or attaching them to a bug report.
+ */
+struct MemoryRingSink : LogSink
+{
+    explicit MemoryRingSink(size_t capacity);
+    
+    void writeBatch(const char* data, size_t numBytes) override;
+    
+    /**
+     any thread. The messages that are still in the ring, oldest first, starting at the first whole message.
+     */
+    juce::String getRecentText() const;
+private:
+    juce::CriticalSection lock;
+    juce::HeapBlock<char> ring;
+    const size_t capacity;
+    size_t writePosition = 0;
+    bool hasWrapped = false;
+};
+
+/**
+ Runs another sink on its own thread, behind its own bounded queue, so that a slow sink only ever holds itself up.
+ 
+ Each batch is copied into the queue, and the sink's thread writes it out.
+ When the queue is full, its `OverflowOptions` decide what happens to the batch. `OverflowPolicy::DropOldest` or `OverflowPolicy::DropNewest` never wait.
+ Whenever batches have been dropped, the sink is told how many before the next batch that does get through.
+ 
+ Batches that are still queued when the `AsyncLogSink` is destroyed are written out by the destructor.
+ */
+struct AsyncLogSink : LogSink
+{
+    static constexpr size_t QueueCapacity = 64;
+    
+    AsyncLogSink(std::unique_ptr<LogSink> sink, OverflowOptions overflowOptions);
+    ~AsyncLogSink() override;
+    
+    //only one thread may write at a time
+    void writeBatch(const char* data, size_t numBytes) override;
+    
+    juce::uint64 getNumDroppedBatches() const { return queue.getNumDropped(); }
+private:
+    std::unique_ptr<LogSink> sink;
+    OverflowingProducerQueue<std::string, QueueCapacity> queue;
+    juce::WaitableEvent batchesQueued;
+    
+    std::vector<std::string> drained;
+    juce::uint64 numDroppedReported = 0;
+    
+    std::unique_ptr<ThreadRunner<AsyncLogSink>> sinkThread;
+    
+    bool canRunSinkThread() { return true; }
+    void writeOnBackgroundThread(juce::Thread& thread);
+    void writeQueuedBatches();
+    
+    JUCE_DECLARE_NON_COPYABLE(AsyncLogSink)
+};
@@ -10,31 +10,73 @@
 
 #include "LoggerWithOptionalCout.h"
 
-LoggerWithOptionalCout::LoggerWithOptionalCout(LoggerWithOptionalCout::LogOptions b, std::unique_ptr<juce::FileLogger> logger ) : writeToCout(b)
+LoggerWithOptionalCout::LoggerWithOptionalCout(LoggerWithOptionalCout::LogOptions b,
+                                               std::unique_ptr<juce::FileLogger> logger,
+                                               WriteDurability durability,
+                                               LogRotationOptions rotation) :
+fileLogger(std::move(logger))
 {
-    fileLogger = std::move(logger);
-    juce::Logger::setCurrentLogger(fileLogger.get());
+    if( fileLogger != nullptr )
+    {
+        fileSink = std::make_unique<FileSink>(fileLogger->getLogFile(), durability, rotation);
+    }
+    
+    if( b == LogOptions::LogToCout )
+    {
+        addSink(std::make_unique<ConsoleSink>(ConsoleSink::Stream::StdOut), { OverflowPolicy::DropOldest });
+    }
+    
+    juce::Logger::setCurrentLogger(&forwardingLogger);
 }
 
 LoggerWithOptionalCout::~LoggerWithOptionalCout()
 {
-    juce::Logger::setCurrentLogger(nullptr);
+    //a newer LoggerWithOptionalCout may have replaced this one as the juce::Logger already
+    if( juce::Logger::getCurrentLogger() == &forwardingLogger )
+        juce::Logger::setCurrentLogger(nullptr);
 }
 
 const juce::File& LoggerWithOptionalCout::getLogFile() const
 {
+    jassert(fileLogger != nullptr);
     return fileLogger->getLogFile();
 }
 
+void LoggerWithOptionalCout::addSink(std::unique_ptr<LogSink> sink, OverflowOptions overflowOptions)
+{
+    jassert(sink != nullptr);
+    
+    auto asyncSink = std::make_unique<AsyncLogSink>(std::move(sink), overflowOptions);
+    
+    const juce::ScopedLock lock(writeLock);
+    sinks.push_back(std::move(asyncSink));
+}
+
+bool LoggerWithOptionalCout::hasSinks() const
+{
+    const juce::ScopedLock lock(writeLock);
+    return sinks.empty() == false;
+}
+
 void LoggerWithOptionalCout::logMessage(const juce::String& message)
 {
-    if (writeToCout == LogOptions::LogToCout)
+    juce::MemoryOutputStream line;
+    line << message << juce::newLine;
+    
+    logBatch(static_cast<const char*>(line.getData()), line.getDataSize());
+}
+
+void LoggerWithOptionalCout::logBatch(const char* data, size_t numBytes)
+{
+    const juce::ScopedLock lock(writeLock);
+    
+    if( fileSink != nullptr )
     {
-        std::cout << message << std::endl;
+        fileSink->writeBatch(data, numBytes);
     }
     
-    if (fileLogger)
+    for( auto& sink : sinks )
     {
-        fileLogger->logMessage(message);
+        sink->writeBatch(data, numBytes);
     }
 }
@@ -11,7 +11,22 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "LogSinks.h"
 
+/**
+ Routes log messages to a log file, and to any number of other sinks: std::cout, a socket, an in-memory ring...
+ 
+ The `juce::FileLogger` creates the log file and writes its welcome message. After that, everything is appended by a `FileSink`,
+ which keeps the file open, and writes each batch from `logBatch()` in one go, on the calling thread.
+ Messages logged with `juce::Logger::writeToLog()` go through the same sinks, so they can't overwrite a batch.
+ 
+ With rotation enabled, the file is checked before each batch, and rotated out if it's full. New files are started without the welcome message.
+ 
+ Every other sink, including std::cout, runs as an `AsyncLogSink`, with its own thread and its own bounded queue.
+ `logBatch()` only copies the batch into each of their queues, so a slow terminal or a stalled collector never holds up the log file, or each other.
+ 
+ `logger` can be nullptr, when the log file is written by someone else (ex: a binary log), and only the other sinks are wanted.
+ */
 struct LoggerWithOptionalCout
 {
     enum class LogOptions
@@ -20,11 +35,43 @@ struct LoggerWithOptionalCout
         DontLogToCout
     };
     
-    LoggerWithOptionalCout(LogOptions includeWritingToCout, std::unique_ptr<juce::FileLogger> logger);
+    LoggerWithOptionalCout(LogOptions includeWritingToCout,
+                           std::unique_ptr<juce::FileLogger> logger,
+                           WriteDurability durability = WriteDurability::FlushPerBatch,
+                           LogRotationOptions rotation = {});
     ~LoggerWithOptionalCout();
     void logMessage(const juce::String&);
+    
+    /**
+     Writes a block of already formatted messages, each ending with a new line, as a single batch.
+     */
+    void logBatch(const char* data, size_t numBytes);
+    
+    /**
+     Adds a sink, which gets every batch from now on, on its own thread.
+     With `LogOptions::LogToCout`, std::cout is added like this, with `OverflowPolicy::DropOldest`, so the terminal keeps up with what's happening now.
+     */
+    void addSink(std::unique_ptr<LogSink> sink, OverflowOptions overflowOptions = {});
+    
+    bool hasLogFile() const { return fileLogger != nullptr; }
+    bool hasSinks() const;
+    
     const juce::File& getLogFile() const;
 private:
-    LogOptions writeToCout;
     std::unique_ptr<juce::FileLogger> fileLogger;
+    
+    //logMessage() can be called from any thread that uses juce::Logger, so the sinks need a lock.
+    juce::CriticalSection writeLock;
+    std::unique_ptr<FileSink> fileSink;
+    std::vector<std::unique_ptr<AsyncLogSink>> sinks;
+    
+    //installed as the juce::Logger, so juce::Logger::writeToLog() ends up in logMessage().
+    struct ForwardingLogger : juce::Logger
+    {
+        explicit ForwardingLogger(LoggerWithOptionalCout& o) : owner(o) { }
+        void logMessage(const juce::String& message) override { owner.logMessage(message); }
+        LoggerWithOptionalCout& owner;
+    };
+    
+    ForwardingLogger forwardingLogger { *this };
 };
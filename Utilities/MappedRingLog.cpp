@@ -0,0 +1,324 @@
+/*
+  ==============================================================================
+
+    MappedRingLog.cpp
+    Created: 17 Oct 2026 12:41:19am
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#include "MappedRingLog.h"
+
+namespace
+{
+    constexpr juce::uint8 ShowTimestampsFlag = 1 << 0;
+    constexpr juce::uint8 OrderByTimeFlag = 1 << 1;
+    constexpr size_t NumSlotsOffset = 8;
+    constexpr size_t SlotSizeOffset = 12;
+    constexpr size_t FlagsOffset = 16;
+    constexpr size_t StartTicksOffset = 24;
+    constexpr size_t TicksPerSecondOffset = 32;
+    constexpr size_t StartTimeMillisOffset = 40;
+    //on its own cache line, as every producer increments it
+    constexpr size_t NextSequenceOffset = 64;
+    
+    enum SlotFlags : juce::uint8
+    {
+        Deferred = 1 << 0,
+        Truncated = 1 << 1,
+        HasLevel = 1 << 2
+    };
+    
+    //the start of every slot. The thread name, category name, format string and data follow it, in that order.
+    struct SlotHeader
+    {
+        juce::uint64 sequence;
+        LogClock::Ticks timeOfCreation;
+        juce::uint16 threadNameLength;
+        juce::uint16 categoryLength;
+        juce::uint16 formatLength;
+        juce::uint16 dataLength;
+        juce::uint8 level;
+        juce::uint8 flags;
+    };
+    
+    constexpr size_t SlotHeaderSize = 32;
+    static_assert(sizeof(SlotHeader) <= SlotHeaderSize);
+    
+    //a slot's sequence number while a writer owns it. Real sequence numbers never get this high.
+    constexpr juce::uint64 BeingWritten = std::numeric_limits<juce::uint64>::max();
+    
+    //the most of `numBytes` of UTF-8 that fits in `space`, without splitting a character
+    size_t fitUTF8(const char* text, size_t numBytes, size_t space)
+    {
+        if( numBytes <= space )
+            return numBytes;
+        
+        auto length = space;
+        while( length > 0 && (static_cast<juce::uint8>(text[length]) & 0xC0) == 0x80 )
+            --length;
+        
+        return length;
+    }
+    
+    //copies as much of the text as fits, and returns how much that was
+    juce::uint16 copyInto(char*& destination, size_t& space, const char* text, size_t numBytes)
+    {
+        auto length = fitUTF8(text, numBytes, std::min(space, static_cast<size_t>(std::numeric_limits<juce::uint16>::max())));
+        std::memcpy(destination, text, length);
+        destination += length;
+        space -= length;
+        return static_cast<juce::uint16>(length);
+    }
+}
+
+MappedRingLog::MappedRingLog(const juce::File& f, CrashRingOptions options, bool showTimestamps, const LogClock& clock) :
+file(f)
+{
+    //slots have to stay 8 byte aligned, for their sequence numbers
+    jassert(options.numSlots > 0 && options.slotSize > static_cast<int>(SlotHeaderSize) && options.slotSize % 8 == 0);
+    
+    numSlots = static_cast<size_t>(options.numSlots);
+    slotSize = static_cast<size_t>(options.slotSize);
+    
+    //a zeroed file is a ring with no messages in it
+    juce::MemoryBlock zeros(HeaderSize + numSlots * slotSize, true);
+    writeHeader(static_cast<char*>(zeros.getData()), numSlots, slotSize, showTimestamps, false, clock);
+    
+    if( file.replaceWithData(zeros.getData(), zeros.getSize()) == false )
+    {
+        jassertfalse; //couldn't create the ring file
+        return;
+    }
+    
+    mapping = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readWrite);
+    if( mapping->getData() == nullptr || mapping->getSize() != zeros.getSize() )
+    {
+        jassertfalse; //couldn't map the ring file
+        mapping.reset();
+        return;
+    }
+    
+    auto* base = static_cast<char*>(mapping->getData());
+    nextSequence = reinterpret_cast<juce::uint64*>(base + NextSequenceOffset);
+    slots = base + HeaderSize;
+}
+
+void MappedRingLog::write(const juce::String& threadName, LogClock::Ticks timeOfCreation, const LogRecord& record)
+{
+    if( openedOk() == false )
+    {
+        return;
+    }
+    
+    auto sequence = std::atomic_ref<juce::uint64>(*nextSequence).fetch_add(1, std::memory_order_relaxed);
+    auto* slot = slots + (sequence % numSlots) * slotSize;
+    auto* header = reinterpret_cast<SlotHeader*>(slot);
+    std::atomic_ref<juce::uint64> committedSequence(header->sequence);
+    
+    /*
+     A writer that was preempted can still be writing a slot when the next lap of the ring comes round to it, or arrive after that lap's writer has finished.
+     So each writer claims the slot first, by swapping the committed sequence for the BeingWritten marker, and only one of them can own it at a time.
+     The claim is given up, and the message left out of the ring, if another writer owns the slot, or it already holds a newer message.
+     */
+    auto committed = committedSequence.load(std::memory_order_relaxed);
+    do
+    {
+        if( committed == BeingWritten || committed > sequence )
+        {
+            return;
+        }
+    }
+    while( committedSequence.compare_exchange_weak(committed, BeingWritten, std::memory_order_acquire, std::memory_order_relaxed) == false );
+    
+    //like a seqlock's writer: the slot is marked as being written before anything else in it changes.
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    fillSlot(slot, slotSize, threadName, timeOfCreation, record);
+    
+    committedSequence.store(sequence + 1, std::memory_order_release);
+}
+
+void MappedRingLog::writeHeader(char* header, size_t numSlots, size_t slotSize, bool showTimestamps, bool orderByTime, const LogClock& clock)
+{
+    auto numSlots32 = static_cast<juce::uint32>(numSlots);
+    auto slotSize32 = static_cast<juce::uint32>(slotSize);
+    auto startTicks = clock.getStartTicks();
+    auto ticksPerSecond = clock.getTicksPerSecond();
+    auto startTimeMillis = clock.getStartTimeMillis();
+    
+    std::memset(header, 0, HeaderSize);
+    std::memcpy(header, Magic, sizeof(Magic));
+    std::memcpy(header + NumSlotsOffset, &numSlots32, sizeof(numSlots32));
+    std::memcpy(header + SlotSizeOffset, &slotSize32, sizeof(slotSize32));
+    header[FlagsOffset] = static_cast<char>((showTimestamps ? ShowTimestampsFlag : 0) | (orderByTime ? OrderByTimeFlag : 0));
+    std::memcpy(header + StartTicksOffset, &startTicks, sizeof(startTicks));
+    std::memcpy(header + TicksPerSecondOffset, &ticksPerSecond, sizeof(ticksPerSecond));
+    std::memcpy(header + StartTimeMillisOffset, &startTimeMillis, sizeof(startTimeMillis));
+}
+
+void MappedRingLog::encodeSlot(char* slot, size_t slotSize, juce::uint64 sequence, LogClock::Ticks timeOfCreation, const LogRecord& record)
+{
+    jassert(slotSize > SlotHeaderSize && reinterpret_cast<juce::pointer_sized_uint>(slot) % 8 == 0);
+    
+    std::memset(slot, 0, slotSize);
+    fillSlot(slot, slotSize, record.getThreadName(), timeOfCreation, record);
+    reinterpret_cast<SlotHeader*>(slot)->sequence = sequence + 1;
+}
+
+void MappedRingLog::fillSlot(char* slot, size_t slotSize, const juce::String& threadName, LogClock::Ticks timeOfCreation, const LogRecord& record)
+{
+    auto* header = reinterpret_cast<SlotHeader*>(slot);
+    auto* destination = slot + SlotHeaderSize;
+    auto space = slotSize - SlotHeaderSize;
+    
+    header->timeOfCreation = timeOfCreation;
+    header->flags = 0;
+    header->level = static_cast<juce::uint8>(record.getLevel());
+    header->threadNameLength = copyInto(destination, space, threadName.toRawUTF8(), threadName.getNumBytesAsUTF8());
+    header->categoryLength = 0;
+    header->formatLength = 0;
+    
+    if( record.hasLevel() )
+    {
+        header->flags |= SlotFlags::HasLevel;
+        if( auto* categoryName = LogCategory::getName(record.getCategoryID()) )
+        {
+            header->categoryLength = copyInto(destination, space, categoryName, std::strlen(categoryName));
+        }
+    }
+    
+    if( record.isDeferred() )
+    {
+        auto* formatString = record.getFormatString();
+        auto formatLength = std::strlen(formatString);
+        
+        if( formatLength + record.getNumBytes() <= space )
+        {
+            header->flags |= SlotFlags::Deferred;
+            header->formatLength = copyInto(destination, space, formatString, formatLength);
+            header->dataLength = copyInto(destination, space, record.getData(), record.getNumBytes());
+        }
+        else
+        {
+            //the arguments can't be cut short, so keep what fits of the format string instead
+            header->dataLength = copyInto(destination, space, formatString, formatLength);
+            header->flags |= SlotFlags::Truncated;
+        }
+    }
+    else
+    {
+        //a record that was truncated already ends with "..."
+        header->dataLength = copyInto(destination, space, record.getData(), record.getNumBytes());
+        if( header->dataLength < record.getNumBytes() )
+        {
+            header->flags |= SlotFlags::Truncated;
+        }
+    }
+}
+
+juce::Result MappedRingLog::recover(const void* data, size_t numBytes, juce::OutputStream& out)
+{
+    auto* bytes = static_cast<const char*>(data);
+    if( numBytes < HeaderSize || std::memcmp(bytes, Magic, sizeof(Magic)) != 0 )
+    {
+        return juce::Result::fail("Not a crash ring file");
+    }
+    
+    juce::uint32 ringNumSlots = 0, ringSlotSize = 0;
+    std::memcpy(&ringNumSlots, bytes + NumSlotsOffset, sizeof(ringNumSlots));
+    std::memcpy(&ringSlotSize, bytes + SlotSizeOffset, sizeof(ringSlotSize));
+    auto showTimestamps = (static_cast<juce::uint8>(bytes[FlagsOffset]) & ShowTimestampsFlag) != 0;
+    auto orderByTime = (static_cast<juce::uint8>(bytes[FlagsOffset]) & OrderByTimeFlag) != 0;
+    
+    LogClock::Ticks startTicks = 0, ticksPerSecond = 0;
+    juce::int64 startTimeMillis = 0;
+    std::memcpy(&startTicks, bytes + StartTicksOffset, sizeof(startTicks));
+    std::memcpy(&ticksPerSecond, bytes + TicksPerSecondOffset, sizeof(ticksPerSecond));
+    std::memcpy(&startTimeMillis, bytes + StartTimeMillisOffset, sizeof(startTimeMillis));
+    
+    if( ringSlotSize <= SlotHeaderSize || numBytes < HeaderSize + static_cast<size_t>(ringNumSlots) * ringSlotSize )
+    {
+        return juce::Result::fail("The crash ring file is shorter than its header says");
+    }
+    
+    if( ticksPerSecond <= 0 )
+    {
+        return juce::Result::fail("The crash ring file's clock is invalid");
+    }
+    
+    LogClock clock(startTicks, ticksPerSecond, startTimeMillis);
+    
+    if( showTimestamps )
+    {
+        out << LogClock::describeTimestamps(clock.getStartTimeMillis()) << juce::newLine;
+    }
+    
+    //collect the slots that were finished being written, and put them back in the order they were logged
+    std::vector<std::pair<juce::uint64, SlotHeader>> entries;
+    for( size_t i = 0; i < ringNumSlots; ++i )
+    {
+        SlotHeader header;
+        std::memcpy(&header, bytes + HeaderSize + i * ringSlotSize, sizeof(header));
+        
+        auto length = static_cast<size_t>(header.threadNameLength) + header.categoryLength + header.formatLength + header.dataLength;
+        if( header.sequence == 0 || header.sequence == BeingWritten || length > ringSlotSize - SlotHeaderSize )
+            continue;
+        
+        entries.emplace_back(i, header);
+    }
+    
+    std::sort(entries.begin(), entries.end(), [orderByTime](const auto& a, const auto& b)
+    {
+        if( orderByTime && a.second.timeOfCreation != b.second.timeOfCreation )
+            return a.second.timeOfCreation < b.second.timeOfCreation;
+        
+        return a.second.sequence < b.second.sequence;
+    });
+    
+    for( const auto& [index, header] : entries )
+    {
+        const auto* text = bytes + HeaderSize + index * ringSlotSize + SlotHeaderSize;
+        auto next = [&text](size_t length)
+        {
+            auto string = juce::String::fromUTF8(text, static_cast<int>(length));
+            text += length;
+            return string;
+        };
+        
+        if( showTimestamps )
+        {
+            LogClock::writeMilliseconds(out, clock.toNanoseconds(header.timeOfCreation));
+            out << ": ";
+        }
+        
+        out << "[" << next(header.threadNameLength) << "]: ";
+        
+        auto categoryName = next(header.categoryLength);
+        if( (header.flags & SlotFlags::HasLevel) != 0 )
+        {
+            out << getLogLevelName(static_cast<LogLevel>(header.level)) << " [" << categoryName << "] ";
+        }
+        
+        if( (header.flags & SlotFlags::Deferred) != 0 )
+        {
+            std::string formatString(text, header.formatLength);
+            text += header.formatLength;
+            out << LogArguments::format(formatString.c_str(), text, header.dataLength);
+        }
+        else
+        {
+            out << next(header.dataLength);
+        }
+        
+        if( (header.flags & SlotFlags::Truncated) != 0 )
+        {
+            out << "...";
+        }
+        
+        out << juce::newLine;
+    }
+    
+    return juce::Result::ok();
+}
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    MappedRingLog.h
+    Created: 17 Oct 2026 12:41:19am
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LogRecord.h"
+#include "LogClock.h"
+
+/**
+ How big the crash ring is. With `numSlots` at 0, there is no crash ring.
+ `slotSize` is the most each message can take up, including its thread name and category. Longer messages are truncated.
+ */
+struct CrashRingOptions
+{
+    int numSlots = 0;
+    int slotSize = 256;
+};
+
+/**
+ A fixed-size, memory-mapped ring of log messages, which survives the process crashing.
+ 
+ Messages are copied into the ring by the threads that log them, as they are logged, so the ring holds the messages that are still
+ waiting in the fifos when the process dies, which are the ones the log file never gets.
+ The ring is just memory, so writing to it doesn't make any syscalls. Once a message is in the ring, it's in the page cache, and the OS writes it to the file even if the process crashes.
+ 
+ The file starts with a 128 byte header: the 8 bytes "BMLRING1", the number of slots, the slot size, a flags byte, the `LogClock`'s start, ticks per second and start time, and at byte 64, the next sequence number.
+ Messages are timestamped in the clock's raw ticks, which `recover()` converts with the clock's details from the header. It starts the text with the wall-clock time that the timestamps count from.
+ Each slot holds one message, and starts with its sequence number, plus one. A writer claims the slot by swapping that for a marker, and the sequence number is only stored once the rest of the slot is,
+ so two writers never write the same slot at once, and a slot that was being written when the process died is never read back.
+ If a writer that fell a lap behind still owns the slot, the message that should have replaced its message is left out of the ring.
+ Slots are reused in turn, so the ring holds the last `numSlots` messages.
+ 
+ `recover()` puts the messages back in the order they were logged, and turns them into the text the text log file would have held.
+ 
+ `writeHeader()` and `encodeSlot()` write the same format into plain memory, for the crash path, which writes a ring file without mapping one.
+ */
+struct MappedRingLog
+{
+    static constexpr char Magic[8] = { 'B', 'M', 'L', 'R', 'I', 'N', 'G', '1' };
+    static constexpr size_t HeaderSize = 128;
+    
+    /**
+     Creates the ring file, replacing whatever was there, and maps it into memory.
+     `clock` is the clock that the messages' timestamps come from.
+     */
+    MappedRingLog(const juce::File& file, CrashRingOptions options, bool showTimestamps, const LogClock& clock);
+    
+    bool openedOk() const { return slots != nullptr; }
+    const juce::File& getFile() const { return file; }
+    
+    /**
+     producer side. Copies the record into the next slot. Lock-free, and safe to call from any number of threads at once.
+     */
+    void write(const juce::String& threadName, LogClock::Ticks timeOfCreation, const LogRecord& record);
+    
+    /**
+     Reads the messages out of a ring file, oldest first.
+     Fails if the data isn't a ring file.
+     */
+    static juce::Result recover(const void* data, size_t numBytes, juce::OutputStream& out);
+    
+    /**
+     Fills in the `HeaderSize` bytes of a ring file's header.
+     With `orderByTime`, `recover()` sorts the messages by their timestamps instead of their sequence numbers, for files whose slots weren't filled in the order the messages were logged.
+     */
+    static void writeHeader(char* destination, size_t numSlots, size_t slotSize, bool showTimestamps, bool orderByTime, const LogClock& clock);
+    
+    /**
+     Fills in a `slotSize` byte slot, which must be 8 byte aligned, with the record, and commits it as `sequence`.
+     Like `writeHeader()`, it doesn't allocate, take a lock, or make a syscall, so it can be used from a signal handler.
+     */
+    static void encodeSlot(char* slot, size_t slotSize, juce::uint64 sequence, LogClock::Ticks timeOfCreation, const LogRecord& record);
+private:
+    juce::File file;
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    
+    char* slots = nullptr;
+    juce::uint64* nextSequence = nullptr;
+    size_t numSlots = 0;
+    size_t slotSize = 0;
+    
+    //everything but the slot's sequence number
+    static void fillSlot(char* slot, size_t slotSize, const juce::String& threadName, LogClock::Ticks timeOfCreation, const LogRecord& record);
+    
+    JUCE_DECLARE_NON_COPYABLE(MappedRingLog)
+};
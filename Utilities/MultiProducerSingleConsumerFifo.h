@@ -11,18 +11,36 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include <Fifo.h>
 #include "Concepts.h"
+#include "OverflowingProducerQueue.h"
+#include "QueueTelemetry.h"
 #include "TimerRunner.h"
+#include "ThreadRunner.h"
 
 /**
  A Multi-Producer Single-Consumer fifo.
  
- It manages the producer objects and consumes elements from each producer using a timed interval of 20ms.
+ It manages the producer objects and consumes elements from each producer.
+ By default, the producers are drained by a timer on the message thread every 20ms.
+ Pass `ConsumerDrainOptions` with `ConsumerDrainMode::ConsumerThread` to the constructor to drain them from a dedicated thread instead,
+ which sleeps until a producer rings its doorbell.
+ With `ConsumerDrainMode::External`, the fifo has neither. The owner drains it from a thread of its own, with `waitForItems()` and `flushAllToConsumerFifo()`.
  
  Usage:
- - First, from your calling thread, create a producer and store the index of that producer.
- - Then, Whenever you need to push from the calling thread, use the index given to you.
+ - First, from your calling thread, create a producer and keep the `Producer` handle that is returned.
+ - Then, Whenever you need to push from the calling thread, push through that handle.
+ - When the handle is destroyed, the producer is retired. Anything still in it is drained by the consumer before its slot is recycled.
+ 
+ Pushing through a `Producer` never takes a lock.
+ Bursts of items can be pushed with `Producer::pushBulk()`, which publishes the whole burst to the consumer at once.
+ Items are moved, never copied, on their way from a `Producer` to `pull()`, so move-only item types work too.
+ Only one thread may push through a given `Producer` at a time.
+ `Producer` handles must not outlive the `MultiProducerSingleConsumerFifo` that created them.
+ 
+ Pass `TelemetryOptions::Enabled` to the constructor to have the fifo count what goes through it. See `getTelemetrySnapshot()`.
+ 
+ Each producer is also identified by a `ProducerID`, which stays valid for as long as the producer exists.
+ The producers live in a generational slot map, so slots are recycled, and an ID that outlives its producer is reported as stale by `isValid(id)`.
  
  ex:
  @code
@@ -31,15 +49,13 @@
  {
      MyBackgroundThreadClass(MPSCFifo& mpsc) :
      juce::Thread("MyBackgroundThreadClass"),
-     mpscfifo(mpsc)
+     producer(mpsc.createProducer())
      {
-         index = mpscfifo.createProducer();
          startThread();
      }
      
      ~MyBackgroundThreadClass() override;
      {
-         mpscfifo.removeProducer(index);
          stopThread(100);
      }
      
@@ -47,18 +63,39 @@
      {
          while( threadShouldExit() == false )
          {
-             //add some data to the MPSC using your index from your background thread
-             mpscfifo.add(data, index);
+             //add some data to the MPSC using your producer from your background thread
+             producer.push(data);
          }
      }
      
-     MPSCFifo& mpscfifo;
-     size_t index;
+     MPSCFifo::Producer producer;
  };
  
  @endcode
  */
 
+enum class ConsumerDrainMode
+{
+    Timer,
+    ConsumerThread,
+    External
+};
+
+/**
+ Controls how the producers of a `MultiProducerSingleConsumerFifo` are drained.
+ 
+ In `ConsumerDrainMode::ConsumerThread` and `ConsumerDrainMode::External`, a producer rings the doorbell when its fifo goes from empty to non-empty, and again when it reaches `batchThreshold` items.
+ The consumer thread wakes on the first ring. If fewer than `batchThreshold` items are waiting, it waits up to `batchWindowMicroseconds` for more before draining.
+ If `maxLatencyMicroseconds` is greater than zero, the consumer also wakes at least that often, even if nobody rang.
+ */
+struct ConsumerDrainOptions
+{
+    ConsumerDrainMode mode = ConsumerDrainMode::Timer;
+    int maxLatencyMicroseconds = 0;
+    int batchThreshold = 1;
+    int batchWindowMicroseconds = 0;
+};
+
 template<typename ItemType>
 struct DefaultNonSorter
 {
@@ -78,147 +115,825 @@ struct MultiProducerSingleConsumerFifo
 {
     using ItemType = T;
     
-    using ProducerFifoType = SimpleMBComp::Fifo<ItemType, ProducerCapacity>;
-    using ConsumerFifoType = SimpleMBComp::Fifo<ItemType, ConsumerCapacity>;
+    using ProducerQueueType = OverflowingProducerQueue<ItemType, ProducerCapacity>;
+    using ConsumerFifoType = SingleProducerSingleConsumerFifo<ItemType, ConsumerCapacity>;
     
-    ~MultiProducerSingleConsumerFifo()
+    /**
+     Identifies a producer's slot.
+     The generation changes every time a slot is recycled, so an ID that outlives its producer can be detected as stale.
+     */
+    struct ProducerID
     {
-        timerRunner.halt();
-        producers.clear();
-    }
+        juce::uint32 index = std::numeric_limits<juce::uint32>::max();
+        juce::uint32 generation = 0;
+        
+        bool operator==(const ProducerID&) const = default;
+    };
     
-    size_t createProducer()
+    static constexpr size_t SlotsPerPage = 64;
+    static constexpr size_t MaxNumPages = 64;
+    static constexpr size_t MaxNumProducers = SlotsPerPage * MaxNumPages;
+private:
+    struct ProducerNode
     {
-        juce::ScopedLock sl(producersLock);
+        ProducerNode(const OverflowOptions& overflowOptions, TelemetryOptions telemetryOptions) : queue(overflowOptions, telemetryOptions) { }
+        
+        ProducerQueueType queue;
+        
+        std::atomic<juce::uint32> generation { 0 };
+        std::atomic<bool> occupied { false };
+        std::atomic<bool> retired { false };
+        
+        //only touched by the consumer
+        bool drainedAfterRetirement = false;
+    };
+    
+    /*
+     Pages of slots are only ever added, and a slot's node is never deleted until the MPSCFifo is,
+     so the consumer can walk the slots without any lock while producers are being created and retired.
+     */
+    struct SlotPage
+    {
+        std::array<std::atomic<ProducerNode*>, SlotsPerPage> nodes {};
+    };
+public:
+    /**
+     An RAII handle to one of the producer fifos.
+     Pushing goes straight into that producer's fifo, without taking any lock.
+     Destroying the handle (or calling `release()`) retires the producer.
+     */
+    struct Producer
+    {
+        Producer() = default;
+        
+        ~Producer()
+        {
+            release();
+        }
+        
+        Producer(Producer&& other) noexcept :
+        owner(std::exchange(other.owner, nullptr)),
+        node(std::exchange(other.node, nullptr)),
+        id(std::exchange(other.id, {}))
+        {
+        }
+        
+        Producer& operator=(Producer&& other) noexcept
+        {
+            if( this != &other )
+            {
+                release();
+                owner = std::exchange(other.owner, nullptr);
+                node = std::exchange(other.node, nullptr);
+                id = std::exchange(other.id, {});
+            }
+            
+            return *this;
+        }
+        
+        bool push(const ItemType& element)
+        {
+            return emplace(element);
+        }
+        
+        bool push(ItemType&& element)
+        {
+            return emplace(std::move(element));
+        }
+        
+        /**
+         Constructs the item directly in this producer's fifo.
+         */
+        template<typename ... Args>
+        bool emplace(Args&& ... args)
+        {
+            if( node != nullptr )
+            {
+                //the slot can't be recycled while this handle holds it
+                jassert(node->generation.load(std::memory_order_relaxed) == id.generation);
+                return owner->emplaceInProducer(*node, std::forward<Args>(args)...);
+            }
+            
+            //if this happens, the producer has already been released, or was never created!
+            //call 'createProducer()' first to get a valid Producer, then call 'push(element)'.
+            jassertfalse;
+            return false;
+        }
+        
+        /**
+         Pushes a burst of items into this producer's fifo, and publishes them to the consumer all at once.
+         Whatever doesn't fit in the fifo is handled by the `OverflowPolicy`, as one batch.
+         
+         @return the number of items that were accepted, from the front of `items`.
+         */
+        size_t pushBulk(std::span<const ItemType> items)
+        {
+            return pushBulkInternal(items.begin(), items.size());
+        }
+        
+        /**
+         Like `pushBulk()`, but moves the items. Only the items that were accepted are moved from.
+         */
+        size_t pushBulkByMoving(std::span<ItemType> items)
+        {
+            return pushBulkInternal(std::make_move_iterator(items.begin()), items.size());
+        }
+        
+        bool isValid() const { return node != nullptr; }
+        
+        ProducerID getID() const { return id; }
+        
+        /**
+         the number of this producer's items that were dropped by the OverflowPolicy.
+         */
+        juce::uint64 getNumDropped() const
+        {
+            return node != nullptr ? node->queue.getNumDropped() : 0;
+        }
+        
+        void release()
+        {
+            if( node != nullptr )
+            {
+                //everything pushed before this point is visible to the consumer once it sees 'retired'
+                node->retired.store(true, std::memory_order_release);
+                owner = nullptr;
+                node = nullptr;
+                id = {};
+            }
+        }
+    private:
+        friend struct MultiProducerSingleConsumerFifo;
+        
+        Producer(MultiProducerSingleConsumerFifo* o, ProducerNode* n, ProducerID i) : owner(o), node(n), id(i) { }
+        
+        template<typename InputIterator>
+        size_t pushBulkInternal(InputIterator first, size_t numItems)
+        {
+            if( node != nullptr )
+            {
+                jassert(node->generation.load(std::memory_order_relaxed) == id.generation);
+                return owner->pushBulkToProducer(*node, first, numItems);
+            }
+            
+            //call 'createProducer()' first to get a valid Producer, then call 'pushBulk(items)'.
+            jassertfalse;
+            return 0;
+        }
         
-        producers.push_back( std::make_unique<ProducerFifoType>() );
-        return producers.size() - 1;
+        MultiProducerSingleConsumerFifo* owner = nullptr;
+        ProducerNode* node = nullptr;
+        ProducerID id;
+        
+        JUCE_DECLARE_NON_COPYABLE(Producer)
+    };
+    
+    explicit MultiProducerSingleConsumerFifo(ConsumerDrainOptions drainOptions = {},
+                                             OverflowOptions overflowOptions = {},
+                                             TelemetryOptions telemetryOptions = TelemetryOptions::Disabled) :
+    options(drainOptions),
+    overflowOptions(overflowOptions),
+    telemetryOptions(telemetryOptions)
+    {
+        if( options.mode == ConsumerDrainMode::ConsumerThread )
+        {
+            consumerThread = std::make_unique<ThreadRunner<ThisClass>>(*this,
+                                                                       "MPSCFifo Consumer",
+                                                                       &ThisClass::drainOnConsumerThread,
+                                                                       &ThisClass::canRunConsumerThread,
+                                                                       ThreadLaunchType::Immediately);
+        }
+        else if( options.mode == ConsumerDrainMode::Timer )
+        {
+            timerRunner.launch();
+        }
     }
     
-    bool removeProducer(size_t index)
+    ~MultiProducerSingleConsumerFifo()
     {
-        juce::ScopedLock sl(producersLock);
-        if( index < producers.size() )
+        timerRunner.halt();
+        
+        if( consumerThread != nullptr )
+        {
+            //the consumer thread is most likely asleep on the doorbell, so wake it up to see that it should exit.
+            consumerThread->signalThreadShouldExit();
+            doorbell.signal();
+            consumerThread.reset();
+        }
+        
+        juce::ScopedLock sl(registrationLock);
+        for( auto& page : pages )
         {
-            if( producers[index] != nullptr)
+            if( auto* p = page.exchange(nullptr) )
             {
-                flushAllToConsumerFifo(); //drain it before deleting
-                
-                auto it = producers.begin();
-                std::advance(it, index);
-                producers.erase(it);
+                for( auto& node : p->nodes )
+                {
+                    delete node.exchange(nullptr);
+                }
                 
-                return true;
+                delete p;
             }
         }
+    }
+    
+    /**
+     Creates a producer in a free slot, recycling the slot of a retired producer if there is one.
+     Returns an invalid `Producer` if all `MaxNumProducers` slots are in use.
+     */
+    Producer createProducer()
+    {
+        juce::ScopedLock sl(registrationLock);
+        
+        juce::uint32 index = 0;
+        if( freeSlots.empty() == false )
+        {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            auto numSlotsInUse = numSlots.load(std::memory_order_relaxed);
+            if( numSlotsInUse == MaxNumProducers )
+            {
+                //you have too many producers! retire some, or increase MaxNumPages.
+                jassertfalse;
+                return {};
+            }
+            
+            auto& page = pages[numSlotsInUse / SlotsPerPage];
+            if( page.load(std::memory_order_relaxed) == nullptr )
+            {
+                page.store(new SlotPage(), std::memory_order_release);
+            }
+            
+            page.load(std::memory_order_relaxed)->nodes[numSlotsInUse % SlotsPerPage].store(new ProducerNode(overflowOptions, telemetryOptions), std::memory_order_release);
+            index = static_cast<juce::uint32>(numSlotsInUse);
+            
+            //publish the new slot after its node exists
+            numSlots.store(numSlotsInUse + 1, std::memory_order_release);
+        }
+        
+        auto* node = getNode(index);
+        ProducerID id { index, node->generation.load(std::memory_order_relaxed) };
+        node->occupied.store(true, std::memory_order_release);
+        
+        return Producer(this, node, id);
+    }
+    
+    /**
+     Returns false if the producer with this ID has been retired, even if its slot has since been given to a new producer.
+     */
+    bool isValid(ProducerID id) const
+    {
+        if( id.index >= numSlots.load(std::memory_order_acquire) )
+        {
+            return false;
+        }
         
-        return false;
+        auto* node = getNode(id.index);
+        return node->occupied.load(std::memory_order_acquire)
+            && node->retired.load(std::memory_order_acquire) == false
+            && node->generation.load(std::memory_order_acquire) == id.generation;
     }
     
-    bool add(const ItemType& element, size_t index)
+    /**
+     Returns true once the producer with this ID has been retired and everything it pushed has been moved to the consumer fifo.
+     Its slot may have been given to a new producer since.
+     */
+    bool isRetiredAndDrained(ProducerID id)
     {
-        juce::ScopedLock stl(producersLock);
-        if( index < producers.size() )
+        //a slot is reclaimed and its last items are moved to the consumer fifo by the same flush, under consumerLock
+        const juce::ScopedLock sl(consumerLock);
+        if( id.index >= numSlots.load(std::memory_order_acquire) )
+        {
+            return false;
+        }
+        
+        auto* node = getNode(id.index);
+        return node->occupied.load(std::memory_order_acquire) == false
+            || node->generation.load(std::memory_order_acquire) != id.generation;
+    }
+    
+    /**
+     For `ConsumerDrainMode::External`. Sleeps until the producers have something to drain, following the same `ConsumerDrainOptions` as the consumer thread.
+     Returns early if `wakeConsumer()` is called, and returns false if `thread` should exit.
+     Call `flushAllToConsumerFifo()` when it returns true.
+     */
+    bool waitForItems(juce::Thread& thread)
+    {
+        auto maxLatencyMs = options.maxLatencyMicroseconds > 0 ? options.maxLatencyMicroseconds / 1000.0 : -1.0;
+        doorbell.wait(maxLatencyMs);
+        
+        if( thread.threadShouldExit() )
+        {
+            return false;
+        }
+        
+        if( options.batchThreshold > 1 && options.batchWindowMicroseconds > 0 )
         {
-            if( auto p = producers[index].get() )
+            //a producer rings again when its fifo reaches batchThreshold
+            if( getNumItemsWaitingInProducers() < options.batchThreshold )
             {
-                return p->push(element);
+                doorbell.wait(options.batchWindowMicroseconds / 1000.0);
             }
         }
         
-        //if this happens, the producer fifo doesn't exist!
-        //call 'createProducer()' first to get a valid index, then call 'add(element, index)'.
-        jassertfalse;
-        return false;
+        return true;
+    }
+    
+    //wakes whoever is sleeping in waitForItems(), so it can see that its thread should exit.
+    void wakeConsumer()
+    {
+        doorbell.signal();
     }
     
     bool pull(ItemType& item)
     {
-        return consumerFifo.pull(item);
+        if( consumerFifo.pull(item) == false )
+        {
+            return false;
+        }
+        
+        //the last flush left items behind because the consumer fifo was full. now that there is room, the consumer thread needs waking to fetch them.
+        if( waitingForRoom.load(std::memory_order_relaxed) && waitingForRoom.exchange(false, std::memory_order_relaxed) )
+        {
+            doorbell.signal();
+        }
+        
+        return true;
     }
     
     void flushAllToConsumerFifo()
     {
-        auto itemsToPush = gatherLatestFromAllProducers();
-        if( itemsToPush.empty() )
+        juce::ScopedLock sl(consumerLock);
+        
+        auto ticksAtStart = isTelemetryEnabled() ? juce::Time::getHighResolutionTicks() : juce::int64 { 0 };
+        
+        gatherLatestFromAllProducers();
+        reclaimRetiredProducers();
+        moveScratchToConsumerFifo();
+        
+        if( isTelemetryEnabled() )
+        {
+            recordFlush(ticksAtStart);
+        }
+    }
+    
+    /**
+     The number of times a flush had to grow its scratch buffers.
+     These buffers keep their capacity between flushes, so this stops increasing once they have grown to fit the largest flush.
+     If it keeps increasing, flushing is still allocating.
+     */
+    size_t getNumScratchAllocations() const
+    {
+        return numScratchAllocations.load(std::memory_order_relaxed);
+    }
+    
+    /**
+     What the fifo has counted, with `TelemetryOptions::Enabled`.
+     
+     Use the high-water marks to size `ProducerCapacity` and `ConsumerCapacity`:
+     a producer whose high-water mark reaches `ProducerCapacity - 1` has been full, and so has a consumer fifo that reaches `ConsumerCapacity - 1`.
+     
+     Durations are in microseconds. The latency is sampled, see `ProducerTelemetry`.
+     */
+    struct TelemetrySnapshot
+    {
+        struct ProducerStats
+        {
+            ProducerID id;
+            juce::uint64 numEnqueued = 0;
+            juce::uint64 numDropped = 0;
+            int highWaterMark = 0;
+        };
+        
+        std::vector<ProducerStats> producers;
+        
+        juce::uint64 numFlushes = 0;
+        int consumerFifoHighWaterMark = 0;
+        LogScaleHistogram::Counts flushDurationMicroseconds;
+        LogScaleHistogram::Counts itemsPerFlush;
+        LogScaleHistogram::Counts enqueueToDequeueLatencyMicroseconds;
+    };
+    
+    /**
+     Crash path. Hands every item that is still waiting to `visitor`, without removing it:
+     first the consumer fifo's, in the order `pull()` would return them, and then each producer's, in the order they were pushed.
+     It takes no locks and doesn't allocate, so it can be called from a signal handler.
+     Items that the consumer is in the middle of moving from the producers to the consumer fifo are missed.
+     */
+    template<typename Visitor>
+    void peekAll(Visitor&& visitor) const
+    {
+        consumerFifo.peekAll(visitor);
+        
+        auto numSlotsInUse = numSlots.load(std::memory_order_acquire);
+        for( size_t index = 0; index < numSlotsInUse; ++index )
+        {
+            auto* node = getNode(index);
+            if( node != nullptr && node->occupied.load(std::memory_order_acquire) )
+            {
+                node->queue.peekAll(visitor);
+            }
+        }
+    }
+    
+    /**
+     Takes a snapshot of the telemetry, without blocking the producers or the consumer, so it can be called from any thread, ex: a monitoring thread.
+     The counters keep changing while the snapshot is taken, so they aren't guaranteed to be consistent with each other.
+     */
+    TelemetrySnapshot getTelemetrySnapshot() const
+    {
+        TelemetrySnapshot snapshot;
+        if( isTelemetryEnabled() == false )
+        {
+            return snapshot;
+        }
+        
+        auto numSlotsInUse = numSlots.load(std::memory_order_acquire);
+        for( size_t index = 0; index < numSlotsInUse; ++index )
+        {
+            auto* node = getNode(index);
+            if( node->occupied.load(std::memory_order_acquire) == false )
+            {
+                continue;
+            }
+            
+            const auto& stats = node->queue.getTelemetry();
+            snapshot.producers.push_back({ ProducerID { static_cast<juce::uint32>(index), node->generation.load(std::memory_order_relaxed) },
+                                           stats.getNumEnqueued(),
+                                           node->queue.getNumDropped(),
+                                           stats.getHighWaterMark() });
+        }
+        
+        snapshot.numFlushes = numFlushes.load(std::memory_order_relaxed);
+        snapshot.consumerFifoHighWaterMark = consumerFifoHighWaterMark.load(std::memory_order_relaxed);
+        snapshot.flushDurationMicroseconds = flushDurationMicroseconds.getCounts();
+        snapshot.itemsPerFlush = itemsPerFlush.getCounts();
+        snapshot.enqueueToDequeueLatencyMicroseconds = enqueueToDequeueLatencyMicroseconds.getCounts();
+        
+        return snapshot;
+    }
+private:
+    void moveScratchToConsumerFifo()
+    {
+        if( scratch.empty() )
         {
             return;
         }
         
+        /*
+         each producer's run is already in order when the sorter's key never decreases within a producer,
+         so the runs only need merging instead of a full std::sort()
+         */
+        if constexpr( IsMonotonicSorterType<SortFunc, ItemType> )
+        {
+            mergeRunsIntoConsumerFifo();
+            return;
+        }
+        
         //if sortFunc is not defaultNonSorter, skip calling std::sort()
         if constexpr( std::is_same_v<SortFunc, DefaultNonSorter<ItemType>> == false )
         {
-            std::sort(itemsToPush.begin(),
-                      itemsToPush.end(),
+            std::sort(scratch.begin(),
+                      scratch.end(),
                       SortFunc::compare);
         }
         
-        flushAll(itemsToPush);
+        flushAll();
     }
-private:
-    juce::CriticalSection producersLock;
     
-    std::vector< std::unique_ptr<ProducerFifoType> > producers;
+    /*
+     The producers live in a generational slot map.
+     createProducer() and the consumer's reclaimRetiredProducers() take 'registrationLock' to hand out and give back free slots.
+     The consumer walks the first 'numSlots' slots without any lock, and skips the ones that aren't occupied.
+     */
+    juce::CriticalSection registrationLock;
+    std::array<std::atomic<SlotPage*>, MaxNumPages> pages {};
+    std::atomic<size_t> numSlots { 0 };
+    std::vector<juce::uint32> freeSlots;
+    
+    //serializes the callers of flushAllToConsumerFifo(). Producers never touch it.
+    juce::CriticalSection consumerLock;
     ConsumerFifoType consumerFifo;
     
+    struct Cursor
+    {
+        size_t next, end;
+    };
+    
+    //scratch space for flushAllToConsumerFifo(). These are cleared, but never shrunk, so steady-state flushing doesn't allocate.
+    std::vector<ItemType> scratch;
+    std::vector<size_t> scratchRunEnds;
+    std::vector<Cursor> mergeHeap;
+    std::atomic<size_t> numScratchAllocations { 0 };
+    
+    const ConsumerDrainOptions options;
+    const OverflowOptions overflowOptions;
+    const TelemetryOptions telemetryOptions;
+    juce::WaitableEvent doorbell;
+    std::atomic<bool> waitingForRoom { false };
+    
+    //where the next flush starts walking the producers, so the same producers don't always get first pick of the consumer fifo's free space.
+    size_t nextProducerToDrain = 0;
+    
     using ThisClass = MultiProducerSingleConsumerFifo;
     TimerRunner<ThisClass, 20> timerRunner
     {
         *this,
         &ThisClass::flushAllToConsumerFifo,
-        TimerLaunchType::StartImmediately
+        TimerLaunchType::StartWhenSignaled
     };
     
-    std::vector<ItemType> gatherLatestFromAllProducers()
+    std::unique_ptr<ThreadRunner<ThisClass>> consumerThread;
+    
+    //only written by the consumer, with consumerLock held
+    std::atomic<juce::uint64> numFlushes { 0 };
+    std::atomic<int> consumerFifoHighWaterMark { 0 };
+    LogScaleHistogram flushDurationMicroseconds;
+    LogScaleHistogram itemsPerFlush;
+    LogScaleHistogram enqueueToDequeueLatencyMicroseconds;
+    
+    bool isTelemetryEnabled() const { return telemetryOptions == TelemetryOptions::Enabled; }
+    
+    static juce::uint64 ticksToMicroseconds(juce::int64 ticks)
+    {
+        return static_cast<juce::uint64>(juce::jmax(0.0, juce::Time::highResolutionTicksToSeconds(ticks) * 1'000'000.0));
+    }
+    
+    void recordFlush(juce::int64 ticksAtStart)
+    {
+        flushDurationMicroseconds.record(ticksToMicroseconds(juce::Time::getHighResolutionTicks() - ticksAtStart));
+        itemsPerFlush.record(scratch.size());
+        numFlushes.store(numFlushes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        
+        auto numInConsumerFifo = consumerFifo.getNumAvailableForReading();
+        if( numInConsumerFifo > consumerFifoHighWaterMark.load(std::memory_order_relaxed) )
+        {
+            consumerFifoHighWaterMark.store(numInConsumerFifo, std::memory_order_relaxed);
+        }
+    }
+    
+    void recordLatencySample(ProducerNode& node)
+    {
+        juce::int64 ticksWhenEnqueued = 0;
+        if( node.queue.getTelemetry().takeLatencySample(ticksWhenEnqueued) )
+        {
+            enqueueToDequeueLatencyMicroseconds.record(ticksToMicroseconds(juce::Time::getHighResolutionTicks() - ticksWhenEnqueued));
+        }
+    }
+    
+    template<typename ... Args>
+    bool emplaceInProducer(ProducerNode& node, Args&& ... args)
+    {
+        return node.queue.emplace([this](int numWaiting, int numPushed) { ringDoorbellIfNeeded(numWaiting, numPushed); },
+                                  std::forward<Args>(args)...);
+    }
+    
+    template<typename InputIterator>
+    size_t pushBulkToProducer(ProducerNode& node, InputIterator first, size_t numItems)
+    {
+        return node.queue.pushRange([this](int numWaiting, int numPushed) { ringDoorbellIfNeeded(numWaiting, numPushed); },
+                                    first,
+                                    numItems);
+    }
+    
+    /*
+     numWaiting is how many items the producer holds now, including the numPushed it just added.
+     only ring on the transitions the consumer cares about, so a steady stream of pushes doesn't signal every time.
+     */
+    void ringDoorbellIfNeeded(int numWaiting, int numPushed)
+    {
+        if( options.mode == ConsumerDrainMode::Timer || numPushed <= 0 )
+        {
+            return;
+        }
+        
+        auto numWaitingBefore = numWaiting - numPushed;
+        if( numWaitingBefore <= 0 || (numWaitingBefore < options.batchThreshold && numWaiting >= options.batchThreshold) )
+        {
+            doorbell.signal();
+        }
+    }
+    
+    bool canRunConsumerThread() { return true; }
+    
+    void drainOnConsumerThread(juce::Thread& thread)
     {
-        juce::ScopedLock sl(producersLock);
+        if( waitForItems(thread) )
+        {
+            flushAllToConsumerFifo();
+        }
+    }
+    
+    int getNumItemsWaitingInProducers()
+    {
+        juce::ScopedLock sl(consumerLock);
         
-        std::vector<ItemType> latestItems;
-        for( auto& fifo : producers )
+        int numItems = 0;
+        auto numSlotsInUse = numSlots.load(std::memory_order_acquire);
+        for( size_t index = 0; index < numSlotsInUse; ++index )
         {
-            if( fifo != nullptr )
+            auto* node = getNode(index);
+            if( node->occupied.load(std::memory_order_acquire) )
             {
-                ItemType item;
-                while( fifo->pull(item) )
-                {
-                    latestItems.push_back(item);
-                }
+                numItems += node->queue.getNumWaiting();
             }
         }
         
-        return latestItems;
+        return numItems;
+    }
+    
+    //only for slots below numSlots, whose nodes are guaranteed to exist
+    ProducerNode* getNode(size_t index) const
+    {
+        auto* page = pages[index / SlotsPerPage].load(std::memory_order_acquire);
+        return page->nodes[index % SlotsPerPage].load(std::memory_order_acquire);
+    }
+    
+    /*
+     moves everything from each producer into the scratch buffer, up to the free space in the consumer fifo.
+     The items from each producer stay together, in the order they were pushed, and scratchRunEnds gets the end index of each of those runs.
+     */
+    void gatherLatestFromAllProducers()
+    {
+        scratch.clear();
+        scratchRunEnds.clear();
+        
+        auto numSlotsInUse = numSlots.load(std::memory_order_acquire);
+        if( numSlotsInUse == 0 )
+        {
+            return;
+        }
+        
+        auto scratchCapacity = scratch.capacity();
+        auto runEndsCapacity = scratchRunEnds.capacity();
+        
+        auto budget = static_cast<size_t>(juce::jmax(0, consumerFifo.getFreeSpace()));
+        auto first = nextProducerToDrain++ % numSlotsInUse;
+        
+        for( size_t i = 0; i < numSlotsInUse; ++i )
+        {
+            auto* node = getNode((first + i) % numSlotsInUse);
+            if( node->occupied.load(std::memory_order_acquire) == false )
+            {
+                continue;
+            }
+            
+            //read 'retired' before draining, so everything pushed before the producer was released gets drained.
+            auto retired = node->retired.load(std::memory_order_acquire);
+            auto runStart = scratch.size();
+            
+            budget -= node->queue.drainInto(scratch, budget);
+            
+            if( isTelemetryEnabled() )
+            {
+                recordLatencySample(*node);
+            }
+            
+            if( scratch.size() > runStart )
+            {
+                scratchRunEnds.push_back(scratch.size());
+            }
+            
+            if( retired && node->queue.isEmpty() )
+            {
+                node->drainedAfterRetirement = true;
+            }
+        }
+        
+        if( budget == 0 && options.mode != ConsumerDrainMode::Timer )
+        {
+            waitingForRoom.store(true, std::memory_order_relaxed);
+        }
+        
+        if( scratch.capacity() != scratchCapacity || scratchRunEnds.capacity() != runEndsCapacity )
+        {
+            numScratchAllocations.fetch_add(1, std::memory_order_relaxed);
+        }
     }
     
-    void flushAll(const std::vector<ItemType>& itemsToFlush)
+    /*
+     call with consumerLock held, after the slots have been walked.
+     Only the slots of producers that have been retired and fully drained are recycled.
+     The other producers are not touched.
+     */
+    void reclaimRetiredProducers()
     {
-        jassert(itemsToFlush.size() < consumerFifo.getFreeSpace() );
+        //never block on a producer that is registering. try again on the next flush instead.
+        const juce::ScopedTryLock stl(registrationLock);
+        if( stl.isLocked() == false )
+        {
+            return;
+        }
         
-        for( const auto& item : itemsToFlush )
+        auto numSlotsInUse = numSlots.load(std::memory_order_acquire);
+        for( size_t index = 0; index < numSlotsInUse; ++index )
         {
-            //continually try to push this element into the consumer fifo.
-            //if this fails, the consumer fifo isn't being emptied often enough
-            auto result = false;
-            do
+            auto* node = getNode(index);
+            if( node->drainedAfterRetirement == false )
             {
-                result = consumerFifo.push(item);
+                continue;
             }
-            while( result == false );
+            
+            //the queue is already empty, so the node can be reset and reused as-is.
+            node->drainedAfterRetirement = false;
+            node->queue.resetCounters();
+            node->retired.store(false, std::memory_order_relaxed);
+            node->generation.fetch_add(1, std::memory_order_relaxed);
+            node->occupied.store(false, std::memory_order_release);
+            
+            freeSlots.push_back(static_cast<juce::uint32>(index));
         }
     }
+    
+    /*
+     a heap-based k-way merge of the runs, straight into the consumer fifo.
+     O(n log k) for n items from k producers.
+     */
+    void mergeRunsIntoConsumerFifo()
+    {
+        auto& heap = mergeHeap;
+        auto heapCapacity = heap.capacity();
+        heap.clear();
+        
+        size_t runStart = 0;
+        for( auto runEnd : scratchRunEnds )
+        {
+            heap.push_back({runStart, runEnd});
+            runStart = runEnd;
+        }
+        
+        if( heap.capacity() != heapCapacity )
+        {
+            numScratchAllocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        
+        //std::make_heap() puts the largest element first, so compare the other way around to get the earliest item first
+        auto laterThan = [&items = scratch](const Cursor& a, const Cursor& b)
+        {
+            return SortFunc::compare(items[b.next], items[a.next]);
+        };
+        
+        std::make_heap(heap.begin(), heap.end(), laterThan);
+        
+        while( heap.empty() == false )
+        {
+            std::pop_heap(heap.begin(), heap.end(), laterThan);
+            auto& cursor = heap.back();
+            
+            pushToConsumerFifo(std::move(scratch[cursor.next]));
+            
+            if( ++cursor.next == cursor.end )
+            {
+                heap.pop_back();
+            }
+            else
+            {
+                std::push_heap(heap.begin(), heap.end(), laterThan);
+            }
+        }
+    }
+    
+    void flushAll()
+    {
+        for( auto& item : scratch )
+        {
+            pushToConsumerFifo(std::move(item));
+        }
+    }
+    
+    void pushToConsumerFifo(ItemType&& item)
+    {
+        //gatherLatestFromAllProducers() never takes more than the consumer fifo has room for, and only the consumer's reader can change that, by making more room.
+        auto result = consumerFifo.push(std::move(item));
+        jassert(result);
+        juce::ignoreUnused(result);
+    }
 };
 
-template<typename T>
+/**
+ An item with the time it was created. `Timestamp` can be any type that orders with `<`.
+ An integer tick count, like `LogClock::Ticks`, is cheaper to take and to compare than the default milliseconds as a double.
+ */
+template<typename T, typename Timestamp = double>
 struct TimedItem
 {
-    double timeOfCreation;
+    Timestamp timeOfCreation;
     T item;
 };
 
-template<typename T>
+template<typename T, typename Timestamp = double>
 struct TimedItemSort
 {
-    static bool compare(const TimedItem<T>& a,
-                        const TimedItem<T>& b)
+    /*
+     a single producer pushes its TimedItems in creation order,
+     so each producer's items are already sorted and the MPSCFifo only needs to merge them.
+     */
+    static constexpr bool isMonotonicPerProducer = true;
+    
+    static bool compare(const TimedItem<T, Timestamp>& a,
+                        const TimedItem<T, Timestamp>& b)
     {
         return a.timeOfCreation < b.timeOfCreation;
     }
@@ -227,12 +942,13 @@ struct TimedItemSort
 template<
     typename T,
     size_t Capacity = 1'000,
-    size_t ConsumerCapacity = Capacity * 4
+    size_t ConsumerCapacity = Capacity * 4,
+    typename Timestamp = double
 >
 using TimedItemMultiProducerSingleConsumerFifoDefaultSort = 
 MultiProducerSingleConsumerFifo<
-    TimedItem<T>,
-    TimedItemSort<T>, 
+    TimedItem<T, Timestamp>,
+    TimedItemSort<T, Timestamp>, 
     Capacity,
     ConsumerCapacity
 >;
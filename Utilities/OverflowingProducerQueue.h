@@ -0,0 +1,386 @@
+/*
+  ==============================================================================
+
+    OverflowingProducerQueue.h
+    Created: 16 Oct 2026 2:41:08pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SingleProducerSingleConsumerFifo.h"
+#include "QueueTelemetry.h"
+
+/**
+ What a producer's queue does when its fifo is full.
+ 
+ The consumers never take more items than they have room for.
+ Anything that doesn't fit stays in the producer fifos, so when the consumers fall behind, the producers fill up and their policy takes over.
+ 
+ - `BlockWithTimeout`: `push()` waits up to `blockTimeoutMicroseconds` for room, then drops the item.
+ - `DropNewest`: `push()` drops the item that didn't fit.
+ - `DropOldest`: `push()` keeps the item, and the consumer discards that producer's oldest items, so that at most `ProducerCapacity - 1` of its newest items survive.
+ - `SpillToOverflow`: `push()` keeps the item in an unbounded overflow buffer, which the consumer drains after the producer's fifo.
+ 
+ Every dropped item is counted per producer.
+ */
+enum class OverflowPolicy
+{
+    BlockWithTimeout,
+    DropNewest,
+    DropOldest,
+    SpillToOverflow
+};
+
+struct OverflowOptions
+{
+    OverflowPolicy policy = OverflowPolicy::DropNewest;
+    int blockTimeoutMicroseconds = 1'000;
+};
+
+/**
+ A single producer's queue: a lock-free `SingleProducerSingleConsumerFifo`, plus the overflow buffer and drop count that its `OverflowPolicy` needs.
+ This is the per-producer building block of `MultiProducerSingleConsumerFifo` and `ShardedMultiProducerMultiConsumerFifo`.
+ 
+ Only one thread may push at a time, and only one thread may drain at a time.
+ 
+ Every push calls `onPublished(numWaiting, numPushed)` after it has made items visible to the consumer,
+ where `numWaiting` is the number of items now waiting in the fifo or the overflow, including the `numPushed` it just added.
+ The owners use this to decide when to wake their consumers.
+ 
+ With `TelemetryOptions::Enabled`, the queue also keeps a `ProducerTelemetry` about itself.
+ */
+template<typename T, size_t Capacity>
+struct OverflowingProducerQueue
+{
+    using ItemType = T;
+    
+    explicit OverflowingProducerQueue(const OverflowOptions& overflowOptions,
+                                      TelemetryOptions telemetryOptions = TelemetryOptions::Disabled) :
+    options(overflowOptions),
+    telemetryEnabled(telemetryOptions == TelemetryOptions::Enabled)
+    {
+    }
+    
+    template<typename OnPublished, typename ... Args>
+    bool emplace(OnPublished&& onPublished, Args&& ... args)
+    {
+        //the fifo only constructs the item if it has room for it, so the arguments can safely be forwarded again on every retry.
+        if( numOverflowing.load(std::memory_order_acquire) == 0 && fifo.emplace(std::forward<Args>(args)...) )
+        {
+            publish(onPublished, fifo.getNumAvailableForReading(), 1);
+            return true;
+        }
+        
+        switch( options.policy )
+        {
+            case OverflowPolicy::BlockWithTimeout:
+            {
+                auto deadline = getBlockDeadline();
+                while( juce::Time::getHighResolutionTicks() < deadline )
+                {
+                    juce::Thread::yield();
+                    if( fifo.emplace(std::forward<Args>(args)...) )
+                    {
+                        publish(onPublished, fifo.getNumAvailableForReading(), 1);
+                        return true;
+                    }
+                }
+                
+                break;
+            }
+            case OverflowPolicy::DropNewest:
+                break;
+            case OverflowPolicy::DropOldest:
+            case OverflowPolicy::SpillToOverflow:
+            {
+                size_t numWaiting = 0;
+                {
+                    const juce::SpinLock::ScopedLockType sl(overflowLock);
+                    if constexpr( std::is_constructible_v<ItemType, Args...> )
+                    {
+                        overflow.emplace_back(std::forward<Args>(args)...);
+                    }
+                    else
+                    {
+                        overflow.push_back(ItemType{ std::forward<Args>(args)... });
+                    }
+                    
+                    numWaiting = trimOverflow() + static_cast<size_t>(fifo.getNumAvailableForReading());
+                }
+                
+                publish(onPublished, static_cast<int>(numWaiting), 1);
+                return true;
+            }
+        }
+        
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    /**
+     The bulk version of `emplace()`.
+     The items that fit are published with a single `finishedWrite()`, and the rest go through the `OverflowPolicy` together.
+     
+     @return the number of items that were accepted, from `first` onwards.
+     */
+    template<typename OnPublished, typename InputIterator>
+    size_t pushRange(OnPublished&& onPublished, InputIterator first, size_t numItems)
+    {
+        size_t numAccepted = 0;
+        if( numOverflowing.load(std::memory_order_acquire) == 0 )
+        {
+            numAccepted = fifo.pushRange(first, numItems);
+            publish(onPublished, fifo.getNumAvailableForReading(), static_cast<int>(numAccepted));
+        }
+        
+        if( numAccepted == numItems )
+        {
+            return numAccepted;
+        }
+        
+        first += static_cast<std::ptrdiff_t>(numAccepted);
+        
+        switch( options.policy )
+        {
+            case OverflowPolicy::BlockWithTimeout:
+            {
+                auto deadline = getBlockDeadline();
+                while( numAccepted < numItems && juce::Time::getHighResolutionTicks() < deadline )
+                {
+                    juce::Thread::yield();
+                    auto numPushed = fifo.pushRange(first, numItems - numAccepted);
+                    if( numPushed > 0 )
+                    {
+                        publish(onPublished, fifo.getNumAvailableForReading(), static_cast<int>(numPushed));
+                        first += static_cast<std::ptrdiff_t>(numPushed);
+                        numAccepted += numPushed;
+                    }
+                }
+                
+                break;
+            }
+            case OverflowPolicy::DropNewest:
+                break;
+            case OverflowPolicy::DropOldest:
+            case OverflowPolicy::SpillToOverflow:
+            {
+                auto numToSpill = numItems - numAccepted;
+                size_t numWaiting = 0;
+                {
+                    const juce::SpinLock::ScopedLockType sl(overflowLock);
+                    for( size_t i = 0; i < numToSpill; ++i )
+                    {
+                        overflow.push_back(*first++);
+                    }
+                    
+                    numWaiting = trimOverflow() + static_cast<size_t>(fifo.getNumAvailableForReading());
+                }
+                
+                publish(onPublished, static_cast<int>(numWaiting), static_cast<int>(numToSpill));
+                return numItems;
+            }
+        }
+        
+        numDropped.fetch_add(numItems - numAccepted, std::memory_order_relaxed);
+        return numAccepted;
+    }
+    
+    /**
+     Moves up to `maxNumItems` of the oldest items onto the end of `destination`, in the order they were pushed.
+     With `OverflowPolicy::DropOldest`, the items that have been pushed out by newer ones are discarded first.
+     Only the draining thread may call this.
+     
+     @return the number of items that were moved.
+     */
+    size_t drainInto(std::vector<ItemType>& destination, size_t maxNumItems)
+    {
+        size_t numDiscarded = 0;
+        if( options.policy == OverflowPolicy::DropOldest )
+        {
+            numDiscarded = discardOldestOverflowingItems();
+        }
+        
+        auto numDrained = fifo.pullUpTo(maxNumItems, [&destination](std::span<ItemType> region)
+        {
+            destination.insert(destination.end(),
+                               std::make_move_iterator(region.begin()),
+                               std::make_move_iterator(region.end()));
+        });
+        
+        if( numDrained < maxNumItems && numOverflowing.load(std::memory_order_acquire) > 0 )
+        {
+            numDrained += pullFromOverflow(destination, maxNumItems - numDrained);
+        }
+        
+        if( telemetryEnabled )
+        {
+            telemetry.recordDequeued(numDiscarded + numDrained);
+        }
+        
+        return numDrained;
+    }
+    
+    /**
+     Crash path. Hands each waiting item to `visitor`, oldest first, without removing it. See `SingleProducerSingleConsumerFifo::peekAll()`.
+     The overflow is only visited if its lock is free, as the thread that holds it may be the one that crashed.
+     */
+    template<typename Visitor>
+    void peekAll(Visitor&& visitor) const
+    {
+        fifo.peekAll(visitor);
+        
+        if( numOverflowing.load(std::memory_order_acquire) > 0 && overflowLock.tryEnter() )
+        {
+            for( const auto& item : overflow )
+            {
+                visitor(item);
+            }
+            
+            overflowLock.exit();
+        }
+    }
+    
+    int getNumWaiting() const
+    {
+        return fifo.getNumAvailableForReading() + static_cast<int>(numOverflowing.load(std::memory_order_relaxed));
+    }
+    
+    bool isEmpty() const
+    {
+        return fifo.getNumAvailableForReading() == 0 && numOverflowing.load(std::memory_order_acquire) == 0;
+    }
+    
+    /**
+     the number of items that were dropped by the OverflowPolicy.
+     */
+    juce::uint64 getNumDropped() const
+    {
+        return numDropped.load(std::memory_order_relaxed);
+    }
+    
+    bool isTelemetryEnabled() const { return telemetryEnabled; }
+    
+    ProducerTelemetry& getTelemetry() { return telemetry; }
+    const ProducerTelemetry& getTelemetry() const { return telemetry; }
+    
+    //for recycling an empty queue for a new producer
+    void resetCounters()
+    {
+        numDropped.store(0, std::memory_order_relaxed);
+        telemetry.reset();
+    }
+private:
+    SingleProducerSingleConsumerFifo<ItemType, Capacity> fifo;
+    const OverflowOptions options;
+    
+    std::atomic<juce::uint64> numDropped { 0 };
+    
+    const bool telemetryEnabled;
+    ProducerTelemetry telemetry;
+    
+    /*
+     items that didn't fit in the fifo, when using OverflowPolicy::DropOldest or OverflowPolicy::SpillToOverflow.
+     While numOverflowing is not zero, the producer pushes here instead of into the fifo, so the order of its items is kept.
+     */
+    juce::SpinLock overflowLock;
+    std::deque<ItemType> overflow;
+    std::atomic<size_t> numOverflowing { 0 };
+    
+    template<typename OnPublished>
+    void publish(OnPublished& onPublished, int numWaiting, int numPushed)
+    {
+        if( telemetryEnabled )
+        {
+            telemetry.recordPublished(numWaiting, numPushed);
+        }
+        
+        onPublished(numWaiting, numPushed);
+    }
+    
+    juce::int64 getBlockDeadline() const
+    {
+        return juce::Time::getHighResolutionTicks()
+             + juce::Time::getHighResolutionTicksPerSecond() * options.blockTimeoutMicroseconds / 1'000'000;
+    }
+    
+    //call with overflowLock held, after adding to the overflow.
+    size_t trimOverflow()
+    {
+        if( options.policy == OverflowPolicy::DropOldest && overflow.size() >= Capacity )
+        {
+            auto numToDrop = overflow.size() - (Capacity - 1);
+            overflow.erase(overflow.begin(), overflow.begin() + static_cast<std::ptrdiff_t>(numToDrop));
+            numDropped.fetch_add(numToDrop, std::memory_order_relaxed);
+            
+            if( telemetryEnabled )
+            {
+                telemetry.recordDiscardedByProducer(numToDrop);
+            }
+        }
+        
+        numOverflowing.store(overflow.size(), std::memory_order_release);
+        return overflow.size();
+    }
+    
+    /*
+     the overflow only holds items that are newer than everything in the fifo,
+     so it is only drained once the fifo is empty.
+     */
+    size_t pullFromOverflow(std::vector<ItemType>& destination, size_t maxNumItems)
+    {
+        if( fifo.getNumAvailableForReading() > 0 )
+        {
+            return 0;
+        }
+        
+        const juce::SpinLock::ScopedLockType sl(overflowLock);
+        
+        auto numToPull = juce::jmin(maxNumItems, overflow.size());
+        auto end = overflow.begin() + static_cast<std::ptrdiff_t>(numToPull);
+        destination.insert(destination.end(),
+                           std::make_move_iterator(overflow.begin()),
+                           std::make_move_iterator(end));
+        overflow.erase(overflow.begin(), end);
+        numOverflowing.store(overflow.size(), std::memory_order_release);
+        
+        return numToPull;
+    }
+    
+    //for OverflowPolicy::DropOldest: discard the oldest items, so that at most Capacity - 1 of the newest items are left.
+    size_t discardOldestOverflowingItems()
+    {
+        if( numOverflowing.load(std::memory_order_acquire) == 0 )
+        {
+            return 0;
+        }
+        
+        const juce::SpinLock::ScopedLockType sl(overflowLock);
+        
+        auto numInFifo = static_cast<size_t>(fifo.getNumAvailableForReading());
+        auto numItems = numInFifo + overflow.size();
+        if( numItems < Capacity )
+        {
+            return 0;
+        }
+        
+        auto numToDiscard = numItems - (Capacity - 1);
+        //the fifo destroys the items once they have been pulled
+        auto numDiscarded = fifo.pullUpTo(numToDiscard, [](std::span<ItemType>) { });
+        
+        while( numDiscarded < numToDiscard && overflow.empty() == false )
+        {
+            overflow.pop_front();
+            ++numDiscarded;
+        }
+        
+        numOverflowing.store(overflow.size(), std::memory_order_release);
+        numDropped.fetch_add(numDiscarded, std::memory_order_relaxed);
+        return numDiscarded;
+    }
+    
+    JUCE_DECLARE_NON_COPYABLE(OverflowingProducerQueue)
+};
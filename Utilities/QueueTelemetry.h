@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    QueueTelemetry.h
+    Created: 16 Oct 2026 5:02:19pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <bit>
+#include <numeric>
+
+/**
+ Turns on the counters and histograms of a `MultiProducerSingleConsumerFifo`.
+ When telemetry is disabled, none of it is touched, and every snapshot is empty.
+ */
+enum class TelemetryOptions
+{
+    Disabled,
+    Enabled
+};
+
+/**
+ A histogram with log-scale buckets, for sizes and durations that span several orders of magnitude.
+ 
+ Bucket 0 counts values of 0. Bucket `n` counts values from `2^(n-1)` up to `2^n - 1`, so bucket 1 is 1, bucket 2 is 2-3, bucket 3 is 4-7, and so on.
+ Values too big for the last bucket are counted in the last bucket.
+ 
+ Only one thread may `record()` at a time. Any thread can `getCounts()` while it does, without a lock.
+ */
+struct LogScaleHistogram
+{
+    static constexpr size_t NumBuckets = 32;
+    
+    struct Counts
+    {
+        std::array<juce::uint64, NumBuckets> buckets {};
+        
+        juce::uint64 getTotal() const
+        {
+            return std::accumulate(buckets.begin(), buckets.end(), juce::uint64 { 0 });
+        }
+        
+        /**
+         The smallest value whose bucket holds at least `fraction` of the values, counting up from bucket 0.
+         ex: `getUpperBoundOfFraction(0.99)` is roughly the 99th percentile, rounded up to a power of two.
+         */
+        juce::uint64 getUpperBoundOfFraction(double fraction) const
+        {
+            auto total = getTotal();
+            auto target = static_cast<juce::uint64>(std::ceil(fraction * static_cast<double>(total)));
+            
+            juce::uint64 numCounted = 0;
+            for( size_t i = 0; i < NumBuckets; ++i )
+            {
+                numCounted += buckets[i];
+                if( numCounted >= target && numCounted > 0 )
+                {
+                    return getUpperBoundOfBucket(i);
+                }
+            }
+            
+            return 0;
+        }
+    };
+    
+    static size_t getBucketIndex(juce::uint64 value)
+    {
+        return juce::jmin(static_cast<size_t>(std::bit_width(value)), NumBuckets - 1);
+    }
+    
+    static juce::uint64 getUpperBoundOfBucket(size_t bucketIndex)
+    {
+        return bucketIndex == 0 ? 0 : (juce::uint64 { 1 } << bucketIndex) - 1;
+    }
+    
+    void record(juce::uint64 value)
+    {
+        auto& bucket = buckets[getBucketIndex(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    
+    Counts getCounts() const
+    {
+        Counts counts;
+        for( size_t i = 0; i < NumBuckets; ++i )
+        {
+            counts.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        }
+        
+        return counts;
+    }
+private:
+    std::array<std::atomic<juce::uint64>, NumBuckets> buckets {};
+};
+
+/**
+ The counters that an `OverflowingProducerQueue` keeps about itself when telemetry is enabled.
+ 
+ The enqueue-to-dequeue latency is sampled: a producer times one of its items at a time.
+ When it pushes and no item of its own is being timed, it notes the time and the position of the item it just pushed.
+ The consumer checks that position after every drain, and takes the sample once the item has been drained.
+ So timing costs the producer one tick read per drain, instead of one per item.
+ */
+struct ProducerTelemetry
+{
+    //producer side
+    void recordPublished(int numWaiting, int numPushed)
+    {
+        if( numPushed <= 0 )
+        {
+            return;
+        }
+        
+        auto numEnqueuedSoFar = numEnqueued.load(std::memory_order_relaxed) + static_cast<juce::uint64>(numPushed);
+        numEnqueued.store(numEnqueuedSoFar, std::memory_order_relaxed);
+        
+        if( numWaiting > highWaterMark.load(std::memory_order_relaxed) )
+        {
+            highWaterMark.store(numWaiting, std::memory_order_relaxed);
+        }
+        
+        if( probePosition.load(std::memory_order_acquire) == 0 )
+        {
+            probeTicks.store(juce::Time::getHighResolutionTicks(), std::memory_order_relaxed);
+            probePosition.store(numEnqueuedSoFar, std::memory_order_release);
+        }
+    }
+    
+    //producer side, for items that were accepted and then discarded before the consumer saw them.
+    void recordDiscardedByProducer(size_t numDiscarded)
+    {
+        numDiscardedByProducer.fetch_add(numDiscarded, std::memory_order_relaxed);
+    }
+    
+    //consumer side, for items that were drained or discarded by the consumer.
+    void recordDequeued(size_t numItems)
+    {
+        numDequeued += numItems;
+    }
+    
+    /**
+     consumer side. If the timed item has been drained, returns true and sets `ticksWhenEnqueued`, and lets the producer time another one.
+     */
+    bool takeLatencySample(juce::int64& ticksWhenEnqueued)
+    {
+        auto position = probePosition.load(std::memory_order_acquire);
+        if( position == 0 || numDequeued + numDiscardedByProducer.load(std::memory_order_relaxed) < position )
+        {
+            return false;
+        }
+        
+        ticksWhenEnqueued = probeTicks.load(std::memory_order_relaxed);
+        probePosition.store(0, std::memory_order_release);
+        return true;
+    }
+    
+    juce::uint64 getNumEnqueued() const { return numEnqueued.load(std::memory_order_relaxed); }
+    int getHighWaterMark() const { return highWaterMark.load(std::memory_order_relaxed); }
+    
+    //for recycling the queue for a new producer. only call when the queue is empty and nobody is pushing.
+    void reset()
+    {
+        numEnqueued.store(0, std::memory_order_relaxed);
+        highWaterMark.store(0, std::memory_order_relaxed);
+        numDiscardedByProducer.store(0, std::memory_order_relaxed);
+        probePosition.store(0, std::memory_order_relaxed);
+        numDequeued = 0;
+    }
+private:
+    std::atomic<juce::uint64> numEnqueued { 0 };
+    std::atomic<int> highWaterMark { 0 };
+    std::atomic<juce::uint64> numDiscardedByProducer { 0 };
+    
+    //the 1-based position of the item being timed, or 0 if none is.
+    std::atomic<juce::uint64> probePosition { 0 };
+    std::atomic<juce::int64> probeTicks { 0 };
+    
+    //only touched by the consumer
+    juce::uint64 numDequeued = 0;
+};
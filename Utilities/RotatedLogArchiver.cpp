@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    RotatedLogArchiver.cpp
+    Created: 16 Oct 2026 10:52:31pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#include "RotatedLogArchiver.h"
+
+RotatedLogArchiver::RotatedLogArchiver(RotatedFileCompression c, int maxNum) :
+compression(c),
+maxNumRotatedFiles(maxNum)
+{
+    archiveThread = std::make_unique<ThreadRunner<RotatedLogArchiver>>(*this,
+                                                                       "Log Archiver",
+                                                                       &RotatedLogArchiver::archiveOnBackgroundThread,
+                                                                       &RotatedLogArchiver::canRunArchiveThread,
+                                                                       ThreadLaunchType::Immediately,
+                                                                       juce::Thread::Priority::background);
+}
+
+RotatedLogArchiver::~RotatedLogArchiver()
+{
+    //the archive thread is most likely asleep waiting for files, so wake it up to see that it should exit.
+    archiveThread->signalThreadShouldExit();
+    filesAdded.signal();
+    archiveThread.reset();
+    
+    archivePendingFiles();
+}
+
+void RotatedLogArchiver::add(const juce::File& rotatedFile)
+{
+    {
+        const juce::ScopedLock lock(pendingLock);
+        pending.push_back(rotatedFile);
+    }
+    
+    filesAdded.signal();
+}
+
+void RotatedLogArchiver::archiveOnBackgroundThread(juce::Thread& thread)
+{
+    filesAdded.wait(-1);
+    
+    if( thread.threadShouldExit() )
+    {
+        return;
+    }
+    
+    archivePendingFiles();
+}
+
+void RotatedLogArchiver::archivePendingFiles()
+{
+    std::vector<juce::File> files;
+    {
+        const juce::ScopedLock lock(pendingLock);
+        files.swap(pending);
+    }
+    
+    for( const auto& file : files )
+    {
+        archivedFiles.push_back(compression == RotatedFileCompression::GZip ? compress(file) : file);
+    }
+    
+    deleteOldestFiles();
+}
+
+juce::File RotatedLogArchiver::compress(const juce::File& file)
+{
+    auto compressedFile = file.getSiblingFile(file.getFileName() + ".gz");
+    
+    {
+        juce::FileInputStream in(file);
+        juce::FileOutputStream out(compressedFile);
+        if( in.openedOk() == false || out.openedOk() == false )
+        {
+            jassertfalse; //leave the file uncompressed
+            return file;
+        }
+        
+        out.setPosition(0);
+        out.truncate();
+        
+        juce::GZIPCompressorOutputStream gzip(out, -1, juce::GZIPCompressorOutputStream::windowBitsGZIP);
+        gzip.writeFromInputStream(in, -1);
+    }
+    
+    file.deleteFile();
+    return compressedFile;
+}
+
+void RotatedLogArchiver::deleteOldestFiles()
+{
+    if( maxNumRotatedFiles <= 0 )
+    {
+        return;
+    }
+    
+    while( archivedFiles.size() > static_cast<size_t>(maxNumRotatedFiles) )
+    {
+        archivedFiles.front().deleteFile();
+        archivedFiles.pop_front();
+    }
+}
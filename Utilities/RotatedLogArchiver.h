@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    RotatedLogArchiver.h
+    Created: 16 Oct 2026 10:52:31pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ThreadRunner.h"
+
+enum class RotatedFileCompression
+{
+    None,
+    GZip
+};
+
+/**
+ Tidies up the log files that a `BatchedFileWriter` has rotated out, on a background-priority thread, so that rotating never stalls the writer.
+ 
+ Each file handed to `add()` is gzipped to `<name>.gz` if compression is on, and the uncompressed file is deleted.
+ Then, if more than `maxNumRotatedFiles` rotated files have built up, the oldest are deleted.
+ Only files rotated by this archiver are counted, so logs left over from earlier sessions are never touched.
+ 
+ Anything still waiting when the archiver is destroyed is archived by the destructor.
+ */
+struct RotatedLogArchiver
+{
+    RotatedLogArchiver(RotatedFileCompression compression, int maxNumRotatedFiles);
+    ~RotatedLogArchiver();
+    
+    //writer side. Only takes a lock for as long as it takes to queue the file.
+    void add(const juce::File& rotatedFile);
+private:
+    const RotatedFileCompression compression;
+    const int maxNumRotatedFiles;
+    
+    juce::CriticalSection pendingLock;
+    std::vector<juce::File> pending;
+    juce::WaitableEvent filesAdded;
+    
+    //only touched by whoever is archiving. Oldest first.
+    std::deque<juce::File> archivedFiles;
+    
+    std::unique_ptr<ThreadRunner<RotatedLogArchiver>> archiveThread;
+    
+    bool canRunArchiveThread() { return true; }
+    void archiveOnBackgroundThread(juce::Thread& thread);
+    void archivePendingFiles();
+    juce::File compress(const juce::File& file);
+    void deleteOldestFiles();
+};
@@ -0,0 +1,524 @@
+/*
+  ==============================================================================
+
+    ShardedMultiProducerMultiConsumerFifo.h
+    Created: 16 Oct 2026 3:27:44pm
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MultiProducerSingleConsumerFifo.h"
+
+/**
+ A Multi-Producer Multi-Consumer fifo, built from the same per-producer queues as `MultiProducerSingleConsumerFifo`.
+ 
+ The producers are split into shards, one per consumer thread. Each new producer is assigned to the next shard, round-robin.
+ Each consumer thread drains the producers of its own shard. When its shard has nothing waiting, it steals from the producers of the other shards.
+ 
+ A producer is only ever drained by one consumer thread at a time, and that thread hands its items over before any other consumer can take more from it.
+ So the items of each producer are always handed over in the order they were pushed, no matter which consumer threads end up handling them.
+ 
+ There are two kinds of output, chosen with `ShardedConsumerOptions::outputMode`:
+ - `ShardedOutputMode::Handler`: each consumer thread passes every batch that it drains to the `ItemHandler`.
+   The handler is called from all of the consumer threads at once, with batches from different producers, so it must be thread-safe.
+ - `ShardedOutputMode::Merged`: the consumer threads move every batch into a `MultiProducerSingleConsumerFifo`, which merges them using `SortFunc`.
+   Read the merged output with `pull()`, like you would from a `MultiProducerSingleConsumerFifo`.
+   The merge is drained according to `ShardedConsumerOptions::mergedDrainOptions`.
+ 
+ Usage is the same as `MultiProducerSingleConsumerFifo`: create a producer from the thread that pushes, and keep the `Producer` handle that is returned.
+ Pushing through a `Producer` never takes a lock.
+ 
+ ex:
+ @code
+ 
+ ShardedConsumerOptions options;
+ options.numConsumers = 4;
+ 
+ ShardedMultiProducerMultiConsumerFifo<Event> fifo([](std::span<Event> events)
+ {
+     for( auto& event : events )
+     {
+         process(event);
+     }
+ }, options);
+ 
+ //on each producing thread:
+ auto producer = fifo.createProducer();
+ producer.pushBulk(eventsFromThisBlock);
+ 
+ @endcode
+ */
+
+enum class ShardedOutputMode
+{
+    Handler,
+    Merged
+};
+
+/**
+ Controls the consumer threads of a `ShardedMultiProducerMultiConsumerFifo`.
+ 
+ `maxBatchSize` is the most a consumer takes from one producer before moving on to the next one, so one busy producer can't starve the others in its shard.
+ A consumer with nothing to do sleeps until a producer in its shard goes from empty to non-empty, or for `idleWaitMicroseconds`, whichever comes first,
+ and then looks for work in its own shard, and the others.
+ */
+struct ShardedConsumerOptions
+{
+    int numConsumers = 4;
+    ShardedOutputMode outputMode = ShardedOutputMode::Handler;
+    int maxBatchSize = 256;
+    int idleWaitMicroseconds = 1'000;
+    ConsumerDrainOptions mergedDrainOptions;
+};
+
+template<
+    typename T,
+    IsSorterType<T> SortFunc = DefaultNonSorter<T>,
+    size_t ProducerCapacity = 1'000,
+    size_t ConsumerCapacity = ProducerCapacity * 8
+>
+struct ShardedMultiProducerMultiConsumerFifo
+{
+    using ItemType = T;
+    
+    using ProducerQueueType = OverflowingProducerQueue<ItemType, ProducerCapacity>;
+    using MergedFifoType = MultiProducerSingleConsumerFifo<ItemType, SortFunc, ProducerCapacity, ConsumerCapacity>;
+    using ItemHandler = std::function<void(std::span<ItemType> items)>;
+    
+    static constexpr size_t MaxProducersPerShard = 256;
+private:
+    struct ProducerNode
+    {
+        explicit ProducerNode(const OverflowOptions& overflowOptions) : queue(overflowOptions) { }
+        
+        ProducerQueueType queue;
+        
+        std::atomic<bool> occupied { false };
+        std::atomic<bool> retired { false };
+        
+        //set by the consumer that is draining this producer. Nobody else may drain it, or touch mergedProducer, until it is cleared.
+        std::atomic<bool> claimed { false };
+        
+        //for ShardedOutputMode::Merged. Only pushed to by the consumer that has claimed this node.
+        typename MergedFifoType::Producer mergedProducer;
+    };
+    
+    /*
+     Like the slots of a MultiProducerSingleConsumerFifo, the nodes of a shard are only deleted when the fifo is,
+     so the consumers can walk them without any lock while producers are being created and retired.
+     */
+    struct Shard
+    {
+        std::array<std::atomic<ProducerNode*>, MaxProducersPerShard> nodes {};
+        std::atomic<size_t> numSlots { 0 };
+        std::vector<juce::uint32> freeSlots;
+        juce::WaitableEvent doorbell;
+    };
+public:
+    /**
+     An RAII handle to one of the producer queues.
+     Pushing goes straight into that producer's queue, without taking any lock.
+     Destroying the handle (or calling `release()`) retires the producer. Anything still in it is drained before its slot is recycled.
+     */
+    struct Producer
+    {
+        Producer() = default;
+        
+        ~Producer()
+        {
+            release();
+        }
+        
+        Producer(Producer&& other) noexcept :
+        owner(std::exchange(other.owner, nullptr)),
+        node(std::exchange(other.node, nullptr)),
+        shard(std::exchange(other.shard, nullptr))
+        {
+        }
+        
+        Producer& operator=(Producer&& other) noexcept
+        {
+            if( this != &other )
+            {
+                release();
+                owner = std::exchange(other.owner, nullptr);
+                node = std::exchange(other.node, nullptr);
+                shard = std::exchange(other.shard, nullptr);
+            }
+            
+            return *this;
+        }
+        
+        bool push(const ItemType& element)
+        {
+            return emplace(element);
+        }
+        
+        bool push(ItemType&& element)
+        {
+            return emplace(std::move(element));
+        }
+        
+        template<typename ... Args>
+        bool emplace(Args&& ... args)
+        {
+            if( node != nullptr )
+            {
+                return node->queue.emplace(getDoorbellRinger(), std::forward<Args>(args)...);
+            }
+            
+            //call 'createProducer()' first to get a valid Producer, then call 'push(element)'.
+            jassertfalse;
+            return false;
+        }
+        
+        /**
+         Pushes a burst of items, and publishes them to the consumers all at once.
+         @return the number of items that were accepted, from the front of `items`.
+         */
+        size_t pushBulk(std::span<const ItemType> items)
+        {
+            return pushBulkInternal(items.begin(), items.size());
+        }
+        
+        size_t pushBulkByMoving(std::span<ItemType> items)
+        {
+            return pushBulkInternal(std::make_move_iterator(items.begin()), items.size());
+        }
+        
+        bool isValid() const { return node != nullptr; }
+        
+        /**
+         the number of this producer's items that were dropped by the OverflowPolicy.
+         */
+        juce::uint64 getNumDropped() const
+        {
+            return node != nullptr ? node->queue.getNumDropped() : 0;
+        }
+        
+        void release()
+        {
+            if( node != nullptr )
+            {
+                //everything pushed before this point is visible to the consumers once they see 'retired'
+                node->retired.store(true, std::memory_order_release);
+                owner = nullptr;
+                node = nullptr;
+                shard = nullptr;
+            }
+        }
+    private:
+        friend struct ShardedMultiProducerMultiConsumerFifo;
+        
+        Producer(ShardedMultiProducerMultiConsumerFifo* o, ProducerNode* n, Shard* s) : owner(o), node(n), shard(s) { }
+        
+        ShardedMultiProducerMultiConsumerFifo* owner = nullptr;
+        ProducerNode* node = nullptr;
+        Shard* shard = nullptr;
+        
+        //wakes the shard's consumer when this producer goes from empty to non-empty
+        auto getDoorbellRinger()
+        {
+            return [s = shard](int numWaiting, int numPushed)
+            {
+                if( numPushed > 0 && numWaiting - numPushed <= 0 )
+                {
+                    s->doorbell.signal();
+                }
+            };
+        }
+        
+        template<typename InputIterator>
+        size_t pushBulkInternal(InputIterator first, size_t numItems)
+        {
+            if( node != nullptr )
+            {
+                return node->queue.pushRange(getDoorbellRinger(), first, numItems);
+            }
+            
+            //call 'createProducer()' first to get a valid Producer, then call 'pushBulk(items)'.
+            jassertfalse;
+            return 0;
+        }
+        
+        JUCE_DECLARE_NON_COPYABLE(Producer)
+    };
+    
+    /**
+     Creates the fifo, and starts `options.numConsumers` consumer threads.
+     `itemHandler` is required for `ShardedOutputMode::Handler`, and ignored for `ShardedOutputMode::Merged`.
+     */
+    explicit ShardedMultiProducerMultiConsumerFifo(ItemHandler itemHandler,
+                                                   ShardedConsumerOptions consumerOptions = {},
+                                                   OverflowOptions overflowOptions = {}) :
+    handler(std::move(itemHandler)),
+    options(consumerOptions),
+    overflowOptions(overflowOptions)
+    {
+        jassert(options.numConsumers > 0 && options.maxBatchSize > 0);
+        jassert(options.outputMode == ShardedOutputMode::Merged || handler != nullptr);
+        
+        if( options.outputMode == ShardedOutputMode::Merged )
+        {
+            mergedFifo = std::make_unique<MergedFifoType>(options.mergedDrainOptions, overflowOptions);
+        }
+        
+        auto numShards = static_cast<size_t>(juce::jmax(1, options.numConsumers));
+        for( size_t i = 0; i < numShards; ++i )
+        {
+            shards.push_back(std::make_unique<Shard>());
+        }
+        
+        for( size_t i = 0; i < numShards; ++i )
+        {
+            consumers.push_back(std::make_unique<ConsumerThread>(*this, i));
+        }
+        
+        for( auto& consumer : consumers )
+        {
+            consumer->startThread();
+        }
+    }
+    
+    ~ShardedMultiProducerMultiConsumerFifo()
+    {
+        for( auto& consumer : consumers )
+        {
+            consumer->signalThreadShouldExit();
+        }
+        
+        //the consumers are most likely asleep on their doorbells, so wake them up to see that they should exit.
+        for( auto& shard : shards )
+        {
+            shard->doorbell.signal();
+        }
+        
+        consumers.clear();
+        
+        juce::ScopedLock sl(registrationLock);
+        for( auto& shard : shards )
+        {
+            for( auto& node : shard->nodes )
+            {
+                delete node.exchange(nullptr);
+            }
+        }
+    }
+    
+    /**
+     Creates a producer in the next shard, recycling the slot of a retired producer if there is one.
+     Returns an invalid `Producer` if all of the shards are full.
+     */
+    Producer createProducer()
+    {
+        juce::ScopedLock sl(registrationLock);
+        
+        for( size_t attempt = 0; attempt < shards.size(); ++attempt )
+        {
+            auto& shard = *shards[nextShard++ % shards.size()];
+            if( auto* node = getFreeNode(shard) )
+            {
+                if( mergedFifo != nullptr )
+                {
+                    node->mergedProducer = mergedFifo->createProducer();
+                }
+                
+                node->retired.store(false, std::memory_order_relaxed);
+                node->occupied.store(true, std::memory_order_release);
+                return Producer(this, node, &shard);
+            }
+        }
+        
+        //you have too many producers! retire some, or increase MaxProducersPerShard.
+        jassertfalse;
+        return {};
+    }
+    
+    /**
+     For `ShardedOutputMode::Merged` only. Pulls the next item of the merged output.
+     */
+    bool pull(ItemType& item)
+    {
+        jassert(mergedFifo != nullptr);
+        return mergedFifo != nullptr && mergedFifo->pull(item);
+    }
+    
+    /**
+     For `ShardedOutputMode::Merged` only. Merges whatever the consumers have handed over so far, ready for `pull()`.
+     */
+    void flushMergedOutput()
+    {
+        jassert(mergedFifo != nullptr);
+        if( mergedFifo != nullptr )
+        {
+            mergedFifo->flushAllToConsumerFifo();
+        }
+    }
+private:
+    struct ConsumerThread : juce::Thread
+    {
+        ConsumerThread(ShardedMultiProducerMultiConsumerFifo& o, size_t index) :
+        juce::Thread("Sharded MPMCFifo Consumer " + juce::String(static_cast<int>(index))),
+        owner(o),
+        shardIndex(index)
+        {
+            scratch.reserve(static_cast<size_t>(owner.options.maxBatchSize));
+        }
+        
+        ~ConsumerThread() override
+        {
+            stopThread(4000);
+        }
+        
+        void run() override
+        {
+            while( threadShouldExit() == false )
+            {
+                owner.drainOnConsumerThread(*this);
+            }
+        }
+        
+        ShardedMultiProducerMultiConsumerFifo& owner;
+        const size_t shardIndex;
+        
+        //only used by this consumer. It is cleared, but never shrunk, so steady-state draining doesn't allocate.
+        std::vector<ItemType> scratch;
+    };
+    
+    const ItemHandler handler;
+    const ShardedConsumerOptions options;
+    const OverflowOptions overflowOptions;
+    
+    std::unique_ptr<MergedFifoType> mergedFifo;
+    
+    //createProducer() and the consumers' recycleRetiredNode() take 'registrationLock' to hand out and give back free slots.
+    juce::CriticalSection registrationLock;
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t nextShard = 0;
+    
+    std::vector<std::unique_ptr<ConsumerThread>> consumers;
+    
+    //call with registrationLock held
+    ProducerNode* getFreeNode(Shard& shard)
+    {
+        if( shard.freeSlots.empty() == false )
+        {
+            auto index = shard.freeSlots.back();
+            shard.freeSlots.pop_back();
+            return shard.nodes[index].load(std::memory_order_relaxed);
+        }
+        
+        auto numSlotsInUse = shard.numSlots.load(std::memory_order_relaxed);
+        if( numSlotsInUse == MaxProducersPerShard )
+        {
+            return nullptr;
+        }
+        
+        auto* node = new ProducerNode(overflowOptions);
+        shard.nodes[numSlotsInUse].store(node, std::memory_order_release);
+        
+        //publish the new slot after its node exists
+        shard.numSlots.store(numSlotsInUse + 1, std::memory_order_release);
+        return node;
+    }
+    
+    void drainOnConsumerThread(ConsumerThread& consumer)
+    {
+        auto numDrained = drainShard(*shards[consumer.shardIndex], consumer.scratch);
+        
+        //nothing to do in our own shard, so help out with the others, starting with the next one along.
+        for( size_t i = 1; i < shards.size() && numDrained == 0; ++i )
+        {
+            numDrained = drainShard(*shards[(consumer.shardIndex + i) % shards.size()], consumer.scratch);
+        }
+        
+        if( numDrained == 0 && consumer.threadShouldExit() == false )
+        {
+            shards[consumer.shardIndex]->doorbell.wait(options.idleWaitMicroseconds / 1000.0);
+        }
+    }
+    
+    /*
+     takes up to maxBatchSize items from every producer in the shard that isn't already being drained by another consumer,
+     and hands each producer's batch over before letting go of that producer.
+     */
+    size_t drainShard(Shard& shard, std::vector<ItemType>& scratch)
+    {
+        size_t numDrained = 0;
+        auto numSlotsInUse = shard.numSlots.load(std::memory_order_acquire);
+        
+        for( size_t index = 0; index < numSlotsInUse; ++index )
+        {
+            auto* node = shard.nodes[index].load(std::memory_order_acquire);
+            if( node->occupied.load(std::memory_order_acquire) == false )
+            {
+                continue;
+            }
+            
+            if( node->queue.isEmpty() && node->retired.load(std::memory_order_relaxed) == false )
+            {
+                continue;
+            }
+            
+            if( node->claimed.exchange(true, std::memory_order_acquire) )
+            {
+                continue;
+            }
+            
+            //the slot might have been recycled by another consumer before we claimed it.
+            if( node->occupied.load(std::memory_order_acquire) )
+            {
+                //read 'retired' before draining, so everything pushed before the producer was released gets drained.
+                auto retired = node->retired.load(std::memory_order_acquire);
+                
+                scratch.clear();
+                numDrained += node->queue.drainInto(scratch, static_cast<size_t>(options.maxBatchSize));
+                
+                if( scratch.empty() == false )
+                {
+                    handOver(*node, scratch);
+                }
+                
+                if( retired && node->queue.isEmpty() )
+                {
+                    recycleRetiredNode(shard, *node, index);
+                }
+            }
+            
+            node->claimed.store(false, std::memory_order_release);
+        }
+        
+        return numDrained;
+    }
+    
+    void handOver(ProducerNode& node, std::vector<ItemType>& items)
+    {
+        if( options.outputMode == ShardedOutputMode::Handler )
+        {
+            handler(std::span<ItemType>(items));
+            return;
+        }
+        
+        //anything the merged fifo can't take is dealt with by its own OverflowPolicy.
+        node.mergedProducer.pushBulkByMoving(std::span<ItemType>(items));
+    }
+    
+    //call with the node claimed. never block on a producer that is registering. the next drain will try again instead.
+    void recycleRetiredNode(Shard& shard, ProducerNode& node, size_t index)
+    {
+        const juce::ScopedTryLock stl(registrationLock);
+        if( stl.isLocked() == false )
+        {
+            return;
+        }
+        
+        node.mergedProducer.release();
+        node.queue.resetCounters();
+        node.occupied.store(false, std::memory_order_release);
+        shard.freeSlots.push_back(static_cast<juce::uint32>(index));
+    }
+};
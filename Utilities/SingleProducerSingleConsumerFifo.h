@@ -0,0 +1,249 @@
+/*
+  ==============================================================================
+
+    SingleProducerSingleConsumerFifo.h
+    Created: 16 Oct 2026 10:12:31am
+    Author:  Matkat Music LLC
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <span>
+
+/**
+ A lock-free Single-Producer Single-Consumer fifo, built on a `juce::AbstractFifo`.
+ 
+ It has the same `push()`/`pull()` interface as `SimpleMBComp::Fifo`,
+ and adds `pullAll()`, which gives the consumer direct access to everything that is ready for reading, so items can be moved out in bulk.
+ 
+ Items are constructed in their slot when they are pushed, and destroyed when they are pulled,
+ so `T` doesn't need to be default-constructible or copyable. Move-only types like `std::unique_ptr` work fine.
+ 
+ Like `juce::AbstractFifo`, one slot is always kept free, so it holds at most `Capacity - 1` items.
+ */
+template<typename T, size_t Capacity>
+struct SingleProducerSingleConsumerFifo
+{
+    using Type = T;
+    
+    SingleProducerSingleConsumerFifo() = default;
+    
+    ~SingleProducerSingleConsumerFifo()
+    {
+        pullAll([](std::span<T>) { });
+    }
+    
+    bool push(const T& t)
+    {
+        return emplace(t);
+    }
+    
+    bool push(T&& t)
+    {
+        return emplace(std::move(t));
+    }
+    
+    /**
+     Constructs the item directly in the next free slot.
+     The arguments are left untouched if the fifo is full.
+     */
+    template<typename ... Args>
+    bool emplace(Args&& ... args)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if( size1 > 0 )
+        {
+            constructAt(static_cast<size_t>(start1), std::forward<Args>(args)...);
+            fifo.finishedWrite(1);
+            return true;
+        }
+        
+        return false;
+    }
+    
+    /**
+     Copies as many of `items` as there is room for into the fifo, in order, and makes them all available to the consumer at once.
+     
+     @return the number of items that were pushed. The rest of `items` didn't fit.
+     */
+    size_t pushBulk(std::span<const T> items)
+    {
+        return pushRange(items.begin(), items.size());
+    }
+    
+    /**
+     Like `pushBulk()`, but moves the items into the fifo. Only the items that were pushed are moved from.
+     */
+    size_t pushBulkByMoving(std::span<T> items)
+    {
+        return pushRange(std::make_move_iterator(items.begin()), items.size());
+    }
+    
+    /**
+     Constructs up to `numItems` items from `first` onwards, in order, and publishes them with a single `finishedWrite()`.
+     `pushBulk()` and `pushBulkByMoving()` are built on this.
+     
+     @return the number of items that were pushed.
+     */
+    template<typename InputIterator>
+    size_t pushRange(InputIterator first, size_t numItems)
+    {
+        auto numWanted = static_cast<int>(juce::jmin(numItems, Capacity));
+        
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(numWanted, start1, size1, start2, size2);
+        
+        for( int i = 0; i < size1; ++i )
+        {
+            constructAt(static_cast<size_t>(start1 + i), *first++);
+        }
+        
+        for( int i = 0; i < size2; ++i )
+        {
+            constructAt(static_cast<size_t>(start2 + i), *first++);
+        }
+        
+        fifo.finishedWrite(size1 + size2);
+        return static_cast<size_t>(size1 + size2);
+    }
+    
+    bool pull(T& t)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+        if( size1 > 0 )
+        {
+            auto* item = getSlot(static_cast<size_t>(start1));
+            t = std::move(*item);
+            std::destroy_at(item);
+            fifo.finishedRead(1);
+            return true;
+        }
+        
+        return false;
+    }
+    
+    /**
+     Hands up to `maxNumItems` of the items that are ready for reading to `regionHandler`, oldest first, as one or two contiguous `std::span<T>`s.
+     `regionHandler` may move the items out of the spans.
+     The items are destroyed, and their space is given back to the producer, once all of the regions have been handled.
+     
+     @return the number of items that were read.
+     */
+    template<typename RegionHandler>
+    size_t pullUpTo(size_t maxNumItems, RegionHandler&& regionHandler)
+    {
+        auto numWanted = static_cast<int>(juce::jmin(maxNumItems, Capacity));
+        
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numWanted, start1, size1, start2, size2);
+        
+        if( size1 > 0 )
+        {
+            regionHandler(getRegion(start1, size1));
+        }
+        
+        if( size2 > 0 )
+        {
+            regionHandler(getRegion(start2, size2));
+        }
+        
+        if( size1 > 0 )
+        {
+            auto region = getRegion(start1, size1);
+            std::destroy(region.begin(), region.end());
+        }
+        
+        if( size2 > 0 )
+        {
+            auto region = getRegion(start2, size2);
+            std::destroy(region.begin(), region.end());
+        }
+        
+        fifo.finishedRead(size1 + size2);
+        return static_cast<size_t>(size1 + size2);
+    }
+    
+    /**
+     Like `pullUpTo()`, for everything that is ready for reading.
+     */
+    template<typename RegionHandler>
+    size_t pullAll(RegionHandler&& regionHandler)
+    {
+        return pullUpTo(Capacity, std::forward<RegionHandler>(regionHandler));
+    }
+    
+    /**
+     Hands each item that is ready for reading to `visitor`, oldest first, without removing it.
+     This is for the crash path, which has to see what's waiting without taking a lock or allocating.
+     Nothing stops the consumer from pulling the items while they are being visited, so only use it when that can't happen, or no longer matters.
+     */
+    template<typename Visitor>
+    void peekAll(Visitor&& visitor) const
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(static_cast<int>(Capacity), start1, size1, start2, size2);
+        
+        for( int i = 0; i < size1; ++i )
+        {
+            visitor(*getSlot(static_cast<size_t>(start1 + i)));
+        }
+        
+        for( int i = 0; i < size2; ++i )
+        {
+            visitor(*getSlot(static_cast<size_t>(start2 + i)));
+        }
+    }
+    
+    int getNumAvailableForReading() const
+    {
+        return fifo.getNumReady();
+    }
+    
+    int getFreeSpace() const
+    {
+        return fifo.getFreeSpace();
+    }
+private:
+    juce::AbstractFifo fifo { static_cast<int>(Capacity) };
+    
+    //raw storage: a slot only holds a live T between being pushed and being pulled.
+    alignas(T) std::byte storage[sizeof(T) * Capacity];
+    
+    T* getSlot(size_t index)
+    {
+        return std::launder(reinterpret_cast<T*>(storage + index * sizeof(T)));
+    }
+    
+    const T* getSlot(size_t index) const
+    {
+        return std::launder(reinterpret_cast<const T*>(storage + index * sizeof(T)));
+    }
+    
+    std::span<T> getRegion(int start, int size)
+    {
+        return std::span<T>(getSlot(static_cast<size_t>(start)), static_cast<size_t>(size));
+    }
+    
+    template<typename ... Args>
+    void constructAt(size_t index, Args&& ... args)
+    {
+        auto* slot = storage + index * sizeof(T);
+        
+        //aggregates like TimedItem<T> can't be constructed with parentheses on every compiler yet, so fall back to braces.
+        if constexpr( std::is_constructible_v<T, Args...> )
+        {
+            new (slot) T(std::forward<Args>(args)...);
+        }
+        else
+        {
+            new (slot) T{ std::forward<Args>(args)... };
+        }
+    }
+    
+    JUCE_DECLARE_NON_COPYABLE(SingleProducerSingleConsumerFifo)
+};
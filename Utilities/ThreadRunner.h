@@ -57,14 +57,22 @@ struct ThreadRunner : juce::Thread
                  const juce::String& threadName,
                  MemberFn memberFn,
                  CanRun canRunFn,
-                 ThreadLaunchType launchType) :
+                 ThreadLaunchType launchType,
+                 juce::Thread::Priority priority_ = juce::Thread::Priority::normal) :
     juce::Thread(threadName),
     owner(owner_),
     memberFunc(memberFn),
-    canRunFunc(canRunFn)
+    canRunFunc(canRunFn),
+    priority(priority_)
     {
         if( launchType == ThreadLaunchType::Immediately )
-            startThread();
+            launch();
+    }
+    
+    //starts the thread, if it was created with ThreadLaunchType::WaitForSignal
+    void launch()
+    {
+        startThread(priority);
     }
     
     ~ThreadRunner() override
@@ -86,4 +94,5 @@ private:
     OwnerClass& owner;
     MemberFn memberFunc;
     CanRun canRunFunc;
+    juce::Thread::Priority priority;
 };